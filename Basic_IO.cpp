@@ -9,9 +9,8 @@ using namespace al;
 #include <iostream>
 using namespace std;
 
-// handy functions in audio
-float dBtoA (float dBVal) {return powf(10.f, dBVal / 20.f);}
-float ampTodB (float ampVal) {return 20.f * log10f(fabs(ampVal));}
+#include "Objects/Dynamics/Limiter.cpp"
+#include "Objects/Utility/FastMath.cpp" // <- dBtoA, ampTodB, mToF, fToM
 
 // Oscilliscope that inherits from mesh 
 class Oscilliscope : public Mesh {
@@ -46,16 +45,24 @@ protected:
 struct Basic_IO : public App {
   Parameter volControl{"volControl", "", 0.f, -96.f, 6.f};
   Parameter rmsMeter{"rmsMeter", "", -96.f, -96.f, 0.f};
+  Parameter limiterGR{"limiterGR", "", 0.f, -24.f, 0.f}; // <- output limiter gain reduction
   ParameterBool audioOutput{"audioOutput", "", false, 0.f, 1.f};
 
   Oscilliscope scope{static_cast<int>(AudioIO().framesPerSecond())};
+  vector<Limiter> limiters; // <- one per output channel
 
   void onInit() {
+    // output protection, one limiter per output channel
+    for (int channel = 0; channel < audioIO().channelsOut(); channel++) {
+      limiters.emplace_back(static_cast<int>(audioIO().framesPerSecond()));
+    }
+
     // set up GUI
     auto GUIdomain = GUIDomain::enableGUI(defaultWindowDomain());
     auto &gui = GUIdomain->newGUI();
     gui.add(volControl); // add parameter to GUI
     gui.add(rmsMeter);
+    gui.add(limiterGR);
     gui.add(audioOutput); 
   }
 
@@ -98,14 +105,17 @@ struct Basic_IO : public App {
       // feed to analysis buffer
       bufferPower += output;
 
-      // overload detector (assuming 2 output channels)
-      if (io.out(0) > 1.f || io.out(1) > 1.f) {
-        cout << "CLIP!" << endl;
+      // output protection: lookahead limiter on every channel
+      for (int channel = 0; channel < static_cast<int>(limiters.size()); channel++) {
+        io.out(channel) = limiters[channel].processSample(io.out(channel));
       }
     }
 
     bufferPower /= io.framesPerBuffer(); // calculate bufferPower
     rmsMeter = ampTodB(bufferPower); // print to GUI display
+    float reduction = 0.f;
+    for (Limiter& limiter : limiters) { reduction = min(reduction, limiter.getGainReductiondB()); }
+    limiterGR = reduction;
   }
 
   void onDraw(Graphics &g) {
@@ -0,0 +1,241 @@
+// Batch processor: runs the GTRPatch or PitchTest chain over many WAV files
+// in parallel, one file per task, and reports throughput.
+//
+// usage: BatchProcess [options] <file.wav | directory | @list.txt>...
+//   -c gtr|pitch   chain to run (default gtr)
+//   -d <coef>      drive coefficient for gtr (default 1)
+//   -t <tone>      tone 0..1 for gtr (default 0.5)
+//   -r <ratio>     pitch ratio (default 1)
+//   -g <dB>        output gain for pitch (default 0)
+//   -j <threads>   worker threads (default: all cores)
+//   -o <dir>       output directory (default: next to each input)
+//
+// Outputs are named <stem>_<chain>.wav. Under -o, files found in a
+// directory keep their subpath below it. Directory walks skip earlier
+// outputs: files named *_gtr.wav or *_pitch.wav, and anything under -o.
+//
+// Set DSP_KERNELS=sse2|avx2|avx512 to force a kernel set instead of the
+// one picked by CPUID.
+//
+// Build: cmake -S . -B build && cmake --build build --target BatchProcess
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+namespace fs = std::filesystem;
+
+#include "Objects/IO/WavFile.cpp"
+#include "Objects/Chains/GTRChain.cpp"
+#include "Objects/Chains/PitchChain.cpp"
+
+struct Settings {
+  string chain = "gtr";
+  float drive = 1.f;
+  float tone = 0.5f;
+  float ratio = 1.f;
+  float gaindB = 0.f;
+  int threads = 0;
+  string outDir;
+};
+
+// one file to process and where its result goes
+struct Job {
+  string input;
+  string output;
+};
+
+// everything a worker needs, allocated once per thread and reused per file
+struct Worker {
+  static const int blockSize = 4096;
+  static const int maxChannels = 64;
+  vector<float> input = vector<float>(blockSize * maxChannels);
+  vector<float> output = vector<float>(blockSize * maxChannels);
+  vector<unique_ptr<GTRChain>> gtr;
+  vector<unique_ptr<PitchChain>> pitch;
+  double audioSeconds = 0.0;
+  int failures = 0;
+
+  void ensureChains (const Settings& settings, int channels, int sampleRate) {
+    if (settings.chain == "gtr") {
+      gtr.clear(); // <- PitchShift state must not leak between files
+      gtr.emplace_back(new GTRChain(sampleRate));
+      gtr[0]->setDrive(settings.drive);
+      gtr[0]->setTone(settings.tone, true);
+      gtr[0]->setPitchRatio(settings.ratio);
+    } else {
+      pitch.clear();
+      for (int ch = 0; ch < channels; ch++) {
+        pitch.emplace_back(new PitchChain(sampleRate));
+        pitch[ch]->setPitchRatio(settings.ratio);
+        pitch[ch]->setGain(settings.gaindB);
+      }
+    }
+  }
+
+  bool process (const Settings& settings, const Job& job) {
+    WavReader reader;
+    if (!reader.open(job.input.c_str())) { return false; }
+    int channels = reader.getChannels();
+    if (channels > maxChannels) { return false; }
+    int outChannels = settings.chain == "gtr" ? 2 : channels; // <- gtr: dry L, shifted R
+    ensureChains(settings, channels, reader.getSampleRate());
+
+    error_code error;
+    fs::path outParent = fs::path(job.output).parent_path();
+    if (!outParent.empty()) { fs::create_directories(outParent, error); }
+    WavWriter writer;
+    if (!writer.open(job.output.c_str(), outChannels, reader.getSampleRate())) { return false; }
+
+    int frames;
+    while ((frames = reader.read(input.data(), blockSize)) > 0) {
+      if (settings.chain == "gtr") {
+        for (int i = 0; i < frames; i++) {
+          float mono = input[i * channels]; // <- first channel, like io.in(0)
+          gtr[0]->processSample(mono, output[2 * i], output[2 * i + 1]);
+        }
+      } else {
+        for (int i = 0; i < frames * channels; i++) {
+          output[i] = pitch[i % channels]->processSample(input[i]);
+        }
+      }
+      if (!writer.write(output.data(), frames)) { // <- disk full: don't count it as done
+        writer.close();
+        return false;
+      }
+    }
+    if (!writer.close()) { return false; }
+    audioSeconds += reader.getFrames() / static_cast<double>(reader.getSampleRate());
+    return true;
+  }
+};
+
+// true for what an earlier run wrote: a chain suffix on the stem, or a file under outDir
+static bool isOutput (const fs::path& file, const Settings& settings) {
+  string stem = file.stem().string();
+  for (const string suffix : {"_gtr", "_pitch"}) {
+    if (stem.size() > suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      return true;
+    }
+  }
+  if (settings.outDir.empty()) { return false; }
+  error_code error;
+  fs::path relative = fs::weakly_canonical(file, error).lexically_relative(fs::weakly_canonical(settings.outDir, error));
+  return !relative.empty() && *relative.begin() != "..";
+}
+
+static string outputPath (const Settings& settings, const fs::path& file, const fs::path& relative) {
+  fs::path dir = settings.outDir.empty() ? file.parent_path() : fs::path(settings.outDir) / relative.parent_path();
+  return (dir / (file.stem().string() + "_" + settings.chain + ".wav")).lexically_normal().string();
+}
+
+static void addInput (const string& arg, const Settings& settings, vector<Job>& jobs) {
+  if (!arg.empty() && arg[0] == '@') { // list file, one path per line
+    ifstream list(arg.substr(1));
+    string line;
+    while (getline(list, line)) {
+      if (!line.empty()) { addInput(line, settings, jobs); }
+    }
+  } else if (fs::is_directory(arg)) {
+    for (const auto& entry : fs::recursive_directory_iterator(arg)) {
+      string ext = entry.path().extension().string();
+      if (entry.is_regular_file() && (ext == ".wav" || ext == ".WAV") && !isOutput(entry.path(), settings)) {
+        jobs.push_back({entry.path().string(), outputPath(settings, entry.path(), entry.path().lexically_relative(arg))});
+      }
+    }
+  } else {
+    jobs.push_back({arg, outputPath(settings, arg, fs::path(arg).filename())});
+  }
+}
+
+int main (int argc, char* argv[]) {
+  Settings settings;
+  vector<string> args;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "-c" && hasValue) { settings.chain = argv[++i]; }
+    else if (arg == "-d" && hasValue) { settings.drive = atof(argv[++i]); }
+    else if (arg == "-t" && hasValue) { settings.tone = atof(argv[++i]); }
+    else if (arg == "-r" && hasValue) { settings.ratio = atof(argv[++i]); }
+    else if (arg == "-g" && hasValue) { settings.gaindB = atof(argv[++i]); }
+    else if (arg == "-j" && hasValue) { settings.threads = atoi(argv[++i]); }
+    else if (arg == "-o" && hasValue) { settings.outDir = argv[++i]; }
+    else { args.push_back(arg); }
+  }
+  vector<Job> jobs; // <- after parsing, so -o anywhere on the line is known to the walk
+  for (const string& arg : args) { addInput(arg, settings, jobs); }
+  if (jobs.empty() || (settings.chain != "gtr" && settings.chain != "pitch")) {
+    fprintf(stderr, "usage: %s [-c gtr|pitch] [-d drive] [-t tone] [-r ratio] [-g dB] [-j threads] [-o dir] "
+      "<file.wav | dir | @list>...\n", argv[0]);
+    return 1;
+  }
+  error_code error;
+  if (!settings.outDir.empty() && !fs::create_directories(settings.outDir, error) && error) {
+    fprintf(stderr, "can't create %s: %s\n", settings.outDir.c_str(), error.message().c_str());
+    return 1;
+  }
+
+  // two inputs landing on one output would overwrite each other; run neither
+  int failures = 0;
+  set<string> taken, clashes;
+  for (const Job& job : jobs) {
+    if (!taken.insert(job.output).second) { clashes.insert(job.output); }
+  }
+  vector<Job> files;
+  for (const Job& job : jobs) {
+    if (clashes.count(job.output) > 0) {
+      fprintf(stderr, "failed: %s (output %s clashes with another input)\n", job.input.c_str(), job.output.c_str());
+      failures++;
+    } else {
+      files.push_back(job);
+    }
+  }
+  const char* kernelSet = dspKernels().name; // <- detect once, before the workers start
+
+  int numThreads = settings.threads > 0 ? settings.threads : static_cast<int>(thread::hardware_concurrency());
+  if (numThreads > static_cast<int>(files.size())) { numThreads = static_cast<int>(files.size()); }
+  if (numThreads < 1) { numThreads = 1; }
+
+  // thread pool: each worker pulls the next file index until none are left
+  vector<Worker> workers(numThreads);
+  atomic<size_t> nextFile{0};
+  auto start = chrono::steady_clock::now();
+  vector<thread> pool;
+  for (int t = 0; t < numThreads; t++) {
+    pool.emplace_back([&, t] {
+      Worker& worker = workers[t];
+      size_t index;
+      while ((index = nextFile.fetch_add(1)) < files.size()) {
+        if (!worker.process(settings, files[index])) {
+          fprintf(stderr, "failed: %s\n", files[index].input.c_str());
+          worker.failures++;
+        }
+      }
+    });
+  }
+  for (thread& worker : pool) { worker.join(); }
+  double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  double audioSeconds = 0.0;
+  for (const Worker& worker : workers) {
+    audioSeconds += worker.audioSeconds;
+    failures += worker.failures;
+  }
+  double realTimeFactor = audioSeconds / wallSeconds;
+  printf("%zu file(s), %d failed, %.1f s of audio in %.2f s on %d thread(s)\n",
+    jobs.size(), failures, audioSeconds, wallSeconds, numThreads);
+  printf("throughput: %.1fx real time = %.1fx per core x %d cores\n",
+    realTimeFactor, realTimeFactor / numThreads, numThreads);
+  printf("kernels: %s\n", kernelSet);
+  return failures > 0 ? 1 : 0;
+}
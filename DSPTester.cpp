@@ -10,181 +10,72 @@ using namespace std;
 
 #include "Gamma/SamplePlayer.h"
 
-float dBtoA (float dBVal) {return powf(10.f, dBVal / 20.f);}
-float ampTodB (float ampVal) {return 20.f * log10f(fabs(ampVal));}
-float mToF (int midiVal) {return 440.f * powf(2.f, (midiVal - 69) / 12.f);}
-int fToM (float freq) {return 12.f * log2f(freq / 440.f) + 69;}
+#include "Objects/Dynamics/Limiter.cpp"
 
-class ScopeBuffer {
-public:
-  ScopeBuffer (int samprate) : sampleRate(samprate) {}
+#include "Objects/Utility/SilenceGate.cpp"
+#include "Objects/Utility/FastMath.cpp" // <- dBtoA, ampTodB, mToF, fToM
+#include "Objects/Visualization/ScopeBuffer.cpp"
+#include "Objects/Synthesis/WavetableOsc.cpp"
 
-  void writeSample (float sample) {
-    for (int i = 0; i < bufferSize - 1; i++) {
-      buffer[i] = buffer[i + 1];
-    }
-    buffer[bufferSize - 1] = sample;
-  }
-
-  float readSample (int index) {
-    return buffer[index];
-  }
-    
-protected:
-  int sampleRate;
-  static const int bufferSize = 44100; // <- set equal to samplerate
-  float buffer[bufferSize];
-};
-
-
-class Phasor {
-public:
-  Phasor (int samprate) : sampleRate(samprate) {}
-
-  virtual void setSampleRate (int samprate) {
-    sampleRate = samprate;
-    phaseIncrement = frequency / static_cast<float> (sampleRate);
-  }
-
-  virtual void setFrequency (float freq) {
-    frequency = freq;
-    phaseIncrement = frequency / static_cast<float> (sampleRate);
-  }
-
-  virtual float processSample() {
-    float phaseIncrement = frequency / static_cast<float>(sampleRate);
-    phase += phaseIncrement;
-    phase = fmod(phase, 1.f);
-    return phase;
-  }
-
-  virtual float setPhase (float ph) {phase = ph;}
-  virtual float getPhase () {return phase;}
-
-protected:
-  float phase = 0.f;
-  int sampleRate = 44100;
-  float frequency = 1.f;
-  float phaseIncrement = frequency / static_cast<float>(sampleRate);
-};
-
-// sinOsc using Nth-order Taylor Series expansion, N adjustable
-// as seen in Gamma https://github.com/LancePutnam/Gamma 
-class SinOsc : public Phasor {
-public: 
-  SinOsc (int samprate) : 
-  Phasor(samprate) {}
-
-  float processSample() override {
-    phase += phaseIncrement;
-    phase = fmod(phase, 1.f);
-   return taylorNSin(
-    fmod(phase + (0.25f*(frequency-1.f)), 1.f) 
-    * twoPi - pi, 
-   N);
-  }
-
-  float setOrder (int order) {N = order;}
-
-protected:
-  int N = 11; // 11 is good
-  const float pi = static_cast<float>(M_PI);
-  const float twoPi = 2.f * pi;
-  const float nTwoPi = -1.f * twoPi;
-  int factorial (int x) {
-    int output = 1;
-    int n = x;
-    while (n > 1) {
-      output *= n;
-      n -= 1;
-    }
-    return output;
-  }
-
-  float taylorNSin (float x, int order) {
-    float output = x;
-    int n = 3;
-    int sign = -1;
-    while (n <= order) {
-     output += sign * (powf(x, n) / factorial(n));
-      sign *= -1;
-      n += 2;
-    }
-    return output;
-  }
-};
-
-template<typename T>
-class PolyphonyEngine {
-public:
-  PolyphonyEngine (int voices, int samprate) : 
-  numVoices(voices), sampleRate(samprate) {}
-
-  void prepare () {
-    for (int i = 0; i < numVoices; i++) {
-      oscBank.push_back(T (sampleRate));
-    }
-  }
-
-  void setFrequency(float freq) {
-    for (int i = 0; i < numVoices; i++) {
-      oscBank[i].setFrequency((i + 1) * freq);
-    }
-  }
-
-  float processSample() {
-    float output = 0.f;
-    for (int i = 0; i < numVoices; i++) {
-      output += oscBank[i].processSample();
-      if (i == 0) {
-        float diff = oscBank[i].getPhase() - last;
-        if (diff < 0) {
-          for (int j = 1; j < numVoices; j++) {
-            oscBank[j].setPhase(oscBank[i].getPhase());
-          }  
-        }
-      last = oscBank[i].getPhase();
-      }
-    }
-    return output * (1.f / numVoices); // <- should scale as a function of numVoices
-  }
-
-protected:
-  int type;
-  int numVoices;
-  int sampleRate;
-  float last;
-  std::vector<T> oscBank;
-};
+#include "Objects/Synthesis/PolyphonyEngine.cpp"
+#include "Objects/Control/MidiScheduler.cpp"
+#include "Objects/IO/MidiFile.cpp"
+#include "Objects/IO/AlsaMidiInput.cpp" // <- build with -DMIDI_USE_ALSA -lasound for live input
 
 struct DSPTester : public App {
   Parameter volControl{"volControl", "", 0.f, -96.f, 6.f};
   Parameter rmsMeter{"rmsMeter", "", -96.f, -96.f, 0.f};
+  Parameter limiterGR{"limiterGR", "", 0.f, -24.f, 0.f}; // <- output limiter gain reduction
   ParameterInt oscFreq{"oscFreq","", 1, 0, 127};
   ParameterBool audioOutput{"audioOutput", "", false, 0.f, 1.f};
   ParameterBool filePlayback{"filePlayback", "", false, 0.f, 1.f};
+  ParameterBool harmonicMode{"harmonicMode", "", false, 0.f, 1.f};
   gam::SamplePlayer<float, gam::ipl::Linear, gam::phsInc::Loop> player;
 
   ScopeBuffer scopeBuffer{static_cast<int>(AudioIO().framesPerSecond())};
+  SilenceGate outputGate; // <- skips the limiters while muted, once their delay is flushed
+  bool outputIdle = false; // <- muted last block, scope already cleared
+  vector<Limiter> limiters; // <- one per output channel
   Mesh oscScope{Mesh::LINE_STRIP};
 
-  PolyphonyEngine<SinOsc> osc{5, static_cast<int>(AudioIO().framesPerSecond())};
+  PolyphonyEngine<WavetableOsc> osc{5, static_cast<int>(AudioIO().framesPerSecond())};
+  MidiScheduler midi{static_cast<int>(AudioIO().framesPerSecond())};
+  MidiFile midiFile;
+  AlsaMidiInput midiInput{midi};
+  int lastOscFreq = -1; // <- audio thread only, like everything that touches osc
+  int currentNote = -1;
+  float noteGain = 1.f;
+
   void onInit() {
+    // output protection, one limiter per output channel
+    for (int channel = 0; channel < audioIO().channelsOut(); channel++) {
+      limiters.emplace_back(static_cast<int>(audioIO().framesPerSecond()));
+    }
+
     // set up GUI
     auto GUIdomain = GUIDomain::enableGUI(defaultWindowDomain());
     auto &gui = GUIdomain->newGUI();
     gui.add(volControl); // add parameter to GUI
     gui.add(rmsMeter);
+    gui.add(limiterGR);
     gui.add(audioOutput); 
     gui.add(filePlayback); 
     gui.add(oscFreq);
+    gui.add(harmonicMode);
     
     //load file to player
     player.load("../Resources/HuckFinn.wav");
 
     //prepare osc
     osc.prepare();
+    vector<float> sawCycle(2048); // <- band-limited per octave by Wavetable
+    for (int i = 0; i < 2048; i++) { sawCycle[i] = 1.f - 2.f * i / 2048.f; }
+    auto saw = make_shared<const Wavetable>(sawCycle.data(), 2048);
+    for (int i = 0; i < osc.getNumVoices(); i++) { osc.getVoice(i).setTable(saw); }
     osc.setFrequency(1.f);
+
+    midiInput.open("DSPTester");
+    outputGate.setTailLength(limiters.empty() ? 0 : limiters[0].getTailLength());
   }
 
   void onCreate() {
@@ -197,7 +88,6 @@ struct DSPTester : public App {
     for (int i = 0; i < 44100; i++) {
       oscScope.vertices()[i][1] = scopeBuffer.readSample(i);
     }
-    osc.setFrequency(oscFreq); // <- optimzie with if(changed) architecture
   }
 
   bool onKeyDown(const Keyboard &k) override {
@@ -213,43 +103,75 @@ struct DSPTester : public App {
     return true;
   }
 
+  // called by the scheduler on the exact frame of each event
+  void onMidi(const MidiEvent& event) {
+    if (event.isNoteOn()) {
+      currentNote = event.data1;
+      noteGain = event.data2 / 127.f;
+      osc.setFrequency(mToF(event.data1));
+    } else if (event.isNoteOff() && event.data1 == currentNote) {
+      noteGain = 0.f;
+    }
+  }
+
   void onSound(AudioIOData& io) override {
     // audio throughput
     float bufferPower = 0;
     float volFactor = dBtoA(volControl);
-    while(io()) { 
-      if (filePlayback) {
-        for (int channel = 0; channel < io.channelsOut(); channel++) {
-          if (channel % 2 == 0) {
-            io.out(channel) = player(0) * volFactor * audioOutput;
+
+    // only the audio thread touches osc: manual tuning applies when the
+    // slider moves, then MIDI notes in this block take over
+    if (oscFreq != lastOscFreq) {
+      lastOscFreq = oscFreq;
+      osc.setFrequency(oscFreq);
+    }
+    osc.setHarmonicMode(harmonicMode); // recurrence synthesis instead of N sines
+    bool idle = !audioOutput; // <- every output is zero this block
+    bool limiting = outputGate.process(idle, io.framesPerBuffer());
+    if (idle && !outputIdle) { scopeBuffer.clear(); }
+    outputIdle = idle;
+
+    // render in segments split at MIDI event boundaries
+    midi.processBlock(io.framesPerBuffer(),
+      [&](const MidiEvent& event) { onMidi(event); },
+      [&](int start, int end) {
+        for (int frame = start; frame < end; frame++) {
+          if (filePlayback) {
+            for (int channel = 0; channel < io.channelsOut(); channel++) {
+              if (channel % 2 == 0) {
+                io.out(channel, frame) = player(0) * volFactor * audioOutput;
+              } else {
+                io.out(channel, frame) = player(1) * volFactor * audioOutput;
+              }
+            }
           } else {
-            io.out(channel) = player(1) * volFactor * audioOutput;
+            bool noteHeld = noteGain > 0.f && !idle; // <- no note, no synth
+            io.out(0, frame) = noteHeld ? osc.processSample() * noteGain * volFactor : 0.f;
+            io.out(1, frame) = io.out(0, frame);
           }
-        }
-      } else {
-        io.out(0) = osc.processSample() * volFactor * audioOutput;
-        io.out(1) = io.out(0);
-      }
 
-      // feed to oscilliscope
-      if (filePlayback) {
-        scopeBuffer.writeSample((io.out(0) + io.out(1)));
-      } else {
-        //scopeBuffer.writeSample((io.out(0) + io.out(1)));
-        scopeBuffer.writeSample(io.out(0));
-      }
+          // feed to oscilliscope (cleared once above while idle)
+          if (!idle && filePlayback) {
+            scopeBuffer.writeSample((io.out(0, frame) + io.out(1, frame)));
+          } else if (!idle) {
+            scopeBuffer.writeSample(io.out(0, frame));
+          }
 
-      // feed to analysis buffer
-      for (int channel = 0; channel < io.channelsIn(); channel++){
-        bufferPower += powf(io.out(channel), 2);
-      }
-      // overload detector
-      if (io.out(0) > 1.f || io.out(1) > 1.f) {
-        cout << "CLIP!" << endl;
-      }
-    }
+          // feed to analysis buffer
+          for (int channel = 0; channel < io.channelsIn(); channel++){
+            bufferPower += powf(io.out(channel, frame), 2);
+          }
+          // output protection: lookahead limiter on every channel
+          for (int channel = 0; limiting && channel < static_cast<int>(limiters.size()); channel++) {
+            io.out(channel, frame) = limiters[channel].processSample(io.out(channel, frame));
+          }
+        }
+      });
     bufferPower /= io.framesPerBuffer();
     rmsMeter = ampTodB(bufferPower);
+    float reduction = 0.f;
+    for (Limiter& limiter : limiters) { reduction = min(reduction, limiter.getGainReductiondB()); }
+    limiterGR = reduction;
   }
 
   void onDraw(Graphics &g) {
@@ -260,9 +182,15 @@ struct DSPTester : public App {
   }
 };
   
-int main() {
+int main(int argc, char* argv[]) {
   DSPTester app;
 
+  // optional MIDI file to sequence the synth: ./DSPTester song.mid
+  if (argc > 1 && app.midiFile.load(argv[1])) {
+    app.midi.setSequence(&app.midiFile.getEvents());
+    app.noteGain = 0.f; // <- silent until the first note
+  }
+
   // Allows for manual declaration of input and output devices, 
   // but causes unpredictable behavior. Needs investigation.
   app.audioIO().deviceIn(AudioDevice("MacBook Pro Microphone"));
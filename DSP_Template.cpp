@@ -11,10 +11,12 @@ using namespace al;
 #include <cmath>
 using namespace std;
 
-float dBtoA (float dBVal) {return powf(10.f, dBVal / 20.f);}
-float ampTodB (float ampVal) {return 20.f * log10f(fabs(ampVal));}
-float mToF (int midiVal) {return 440.f * powf(2.f, (midiVal - 69) / 12.f);}
-int fToM (float freq) {return 12.f * log2f(freq / 440.f) + 69;}
+#include "Objects/Visualization/SpectrumAnalyzer.cpp"
+#include "Objects/Dynamics/Limiter.cpp"
+
+#include "Objects/Utility/FastMath.cpp" // <- dBtoA, ampTodB, mToF, fToM
+#include "Objects/Synthesis/SinOsc.cpp"
+#include "Objects/Control/ModulationScheduler.cpp"
 
 // Oscilliscope that inherits from mesh 
 class Oscilliscope : public Mesh {
@@ -34,6 +36,8 @@ public:
     buffer[bufferSize - 1] = sample;
   }
 
+  float back () {return buffer[bufferSize - 1];}
+
   void update() {
     for (int i = 0; i < bufferSize; i++) {
       this->vertices()[i][1] = buffer[i];
@@ -45,106 +49,71 @@ protected:
   vector<float> buffer;
 };
 
-// Basic Phase Accumulator
-// Generates unipolar ramp wave from 0 to 1 with adjustable frequency
-class Phasor {
-public:
-  Phasor (int samprate) : sampleRate(samprate) {}
-
-  virtual void setSampleRate (int samprate) {
-    sampleRate = samprate;
-    phaseIncrement = frequency / static_cast<float> (sampleRate);
-  }
-
-  virtual void setFrequency (float freq) {
-    frequency = freq;
-    phaseIncrement = frequency / static_cast<float> (sampleRate);
-  }
-
-  virtual float processSample() {
-    phaseIncrement = frequency / static_cast<float>(sampleRate);
-    phase += phaseIncrement;
-    phase = fmod(phase, 1.f);
-    return phase;
-  }
-
-  virtual void setPhase (float ph) {phase = ph;}
-  virtual float getPhase () {return phase;}
-
-protected:
-  float phase = 0.f;
-  int sampleRate = 44100;
-  float frequency = 1.f;
-  float phaseIncrement = frequency / static_cast<float>(sampleRate);
-};
-
-// Sine Oscillator using Nth-order Taylor Series approximation, N adjustable
-// as seen in Gamma https://github.com/LancePutnam/Gamma 
-class SinOsc : public Phasor {
-public: 
-  SinOsc (int samprate) : Phasor(samprate) {}
-
-  float processSample() override {
-    phase += phaseIncrement;
-    phase = fmod(phase, 1.f);
-   return taylorNSin(phase * -twoPi + pi, N); // map phase to range (-pi,pi), calculate sin
-  }
-
-  float setOrder (int order) {N = order;}
-
-protected:
-  int N = 11; // 11 is good
-  const float pi = static_cast<float>(M_PI);
-  const float twoPi = 2.f * pi;
-
-  int factorial (int x) {
-    int output = 1;
-    int n = x;
-    while (n > 1) {
-      output *= n;
-      n -= 1;
-    }
-    return output;
-  }
-
-  float taylorNSin (float x, int order) {
-    float output = x;
-    int n = 3;
-    int sign = -1;
-    while (n <= order) {
-     output += sign * (powf(x, n) / factorial(n));
-      sign *= -1;
-      n += 2;
-    }
-    return output;
-  }
-};
-
 // app struct
 struct DSP_Template : public App {
   Parameter volControl{"volControl", "", 0.f, -96.f, 6.f};
   Parameter rmsMeter{"rmsMeter", "", -96.f, -96.f, 0.f};
+  Parameter limiterGR{"limiterGR", "", 0.f, -24.f, 0.f}; // <- output limiter gain reduction
   Parameter myFreq{"myFreq", "", 220.f, 1.f, 10000.f};
   Parameter modFreq{"modFreq", "", 0.f, 0.f, 100.f};
   ParameterBool audioOutput{"audioOutput", "", false, 0.f, 1.f};
+  ParameterBool spectrumView{"spectrumView", "", false, 0.f, 1.f};
   Oscilliscope myScope{static_cast<int>(AudioIO().framesPerSecond())};
+  vector<Limiter> limiters; // <- one per output channel
+  SpectrumAnalyzer analyzer{static_cast<int>(AudioIO().framesPerSecond())};
+  Mesh spectrumLine{Mesh::LINE_STRIP};
+  Mesh peakLine{Mesh::LINE_STRIP};
+  vector<float> spectrum, peaks;
+  vector<float> analysisBlock; // <- scratch for the analyzer tap, one buffer long
   SinOsc myOsc{static_cast<int>(AudioIO().framesPerSecond())};
-  SinOsc modOsc{static_cast<int>(AudioIO().framesPerSecond())};
+  ModulationScheduler mod{static_cast<int>(AudioIO().framesPerSecond()), 32}; // <- LFOs every 32 samples
+  int modLFO = mod.addLFO(0.f); // <- runs per sample above ~86 Hz, for FM
+  int freqTarget = mod.addTarget(220.f);
 
   void onInit() {
+    // output protection, one limiter per output channel
+    for (int channel = 0; channel < audioIO().channelsOut(); channel++) {
+      limiters.emplace_back(static_cast<int>(audioIO().framesPerSecond()));
+    }
+    analysisBlock.assign(audioIO().framesPerBuffer(), 0.f);
+
     // set up GUI
     auto GUIdomain = GUIDomain::enableGUI(defaultWindowDomain());
     auto &gui = GUIdomain->newGUI();
     gui.add(volControl); // add parameter to GUI
     gui.add(rmsMeter);
+    gui.add(limiterGR);
     gui.add(audioOutput); 
     gui.add(modFreq); 
+    gui.add(spectrumView);
+
+    float depth = 10.f;
+    mod.connect(modLFO, freqTarget, depth); // <- myFreq +/- depth Hz
   }
 
-  void onCreate() {myOsc.setFrequency(1.f);}
+  void onCreate() {
+    myOsc.setFrequency(1.f);
+    for (int i = 0; i < analyzer.getNumPoints(); i++) { // log-frequency x axis
+      float x = (i / static_cast<float>(analyzer.getNumPoints() - 1)) * 2.f - 1.f;
+      spectrumLine.vertex(x, -1.f);
+      peakLine.vertex(x, -1.f);
+    }
+    analyzer.start();
+  }
+
+  void onExit() {analyzer.stop();}
 
   void onAnimate(double dt) {
-    myScope.update();
+    if (spectrumView) {
+      analyzer.setFrameTime(dt); // update rate follows frame rate
+      analyzer.copySpectrum(spectrum, peaks);
+      for (int i = 0; i < analyzer.getNumPoints(); i++) { // map [-96, 0] dB to [-1, 1]
+        spectrumLine.vertices()[i][1] = std::max(-1.f, spectrum[i] / 48.f + 1.f);
+        peakLine.vertices()[i][1] = std::max(-1.f, peaks[i] / 48.f + 1.f);
+      }
+    } else {
+      myScope.update();
+    }
   }
 
   bool onKeyDown(const Keyboard &k) override {
@@ -152,24 +121,40 @@ struct DSP_Template : public App {
       audioOutput = !audioOutput;
       cout << "Mute Status: " << audioOutput << endl;
     }
+    if (k.key() == 's') { // <- on s, toggle scope/spectrum
+      spectrumView = !spectrumView;
+    }
     return true;
   }
 
   void onSound(AudioIOData& io) override {
-    modOsc.setFrequency(modFreq); // set modulation frequency
+    mod.setFrequency(modLFO, modFreq); // set modulation frequency
+    mod.setBase(freqTarget, myFreq);
+    const float* frequency = nullptr; // <- one per sample, ramped between control points
+    int modStart = 0, modEnd = 0; // <- frames the scheduler has filled, refilled in chunks of its block size
     // audio throughput and analysis
     float bufferPower = 0;
     float volFactor = dBtoA(volControl);
+    bool analyzing = static_cast<int>(analysisBlock.size()) >= io.framesPerBuffer(); // <- sized in onInit
     while(io()) {
-      float depth = 10.f;
-      //myFreq = myFreq + (modOsc.processSample() * depth); // FM
-      myOsc.setFrequency(myFreq + (modOsc.processSample() * depth)); // set freq
+      if (io.frame() == modEnd) {
+        modStart = modEnd;
+        modEnd += mod.processBlock(io.framesPerBuffer() - modStart);
+        frequency = mod.getBlock(freqTarget);
+      }
+      myOsc.setFrequency(frequency[io.frame() - modStart]); // set freq
       float output = myOsc.processSample(); // write output sample
-      //output *= (modOsc.processSample() + 1.f) / 2.f; // AM
+      //output *= (frequency[io.frame() - modStart] - myFreq) / 20.f + 0.5f; // AM
       io.out(0) =  output * volFactor * audioOutput; //write to L channel
       io.out(1) = io.out(0); // copy L channel to R channel
       myScope.writeSample((io.out(0) + io.out(1)) / 2.f); // write samples to osc
+      if (analyzing) { analysisBlock[io.frame()] = myScope.back(); } // stash for the analyzer
+      // output protection: lookahead limiter on every channel
+      for (int channel = 0; channel < static_cast<int>(limiters.size()); channel++) {
+        io.out(channel) = limiters[channel].processSample(io.out(channel));
+      }
     }
+    if (analyzing) { analyzer.writeBlock(analysisBlock.data(), io.framesPerBuffer()); } // one block copy
 
     // feed to analysis buffer
     for (int channel = 0; channel < io.channelsIn(); channel++){
@@ -177,18 +162,22 @@ struct DSP_Template : public App {
     }
     bufferPower /= io.framesPerBuffer();
     rmsMeter = ampTodB(bufferPower);
-
-    // overload detector
-      if (io.out(0) > 1.f || io.out(1) > 1.f) {
-        cout << "CLIP!" << endl;
-    }
+    float reduction = 0.f;
+    for (Limiter& limiter : limiters) { reduction = min(reduction, limiter.getGainReductiondB()); }
+    limiterGR = reduction;
   }
 
   void onDraw(Graphics &g) {
     g.clear(0);
     g.color(1);
     g.camera(Viewpoint::IDENTITY); // Ortho [-1:1] x [-1:1]
-    g.draw(myScope);
+    if (spectrumView) {
+      g.draw(spectrumLine);
+      g.color(1, 0.5, 0);
+      g.draw(peakLine);
+    } else {
+      g.draw(myScope);
+    }
   }
 };
   
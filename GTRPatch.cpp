@@ -10,239 +10,100 @@ using namespace std;
 
 #include "Gamma/SamplePlayer.h"
 
-float dBtoA (float dBVal) {return powf(10.f, dBVal / 20.f);}
-float ampTodB (float ampVal) {return 20.f * log10f(fabs(ampVal));}
-float mToF (int midiVal) {return 440.f * powf(2.f, (midiVal - 69) / 12.f);}
-int fToM (float freq) {return 12.f * log2f(freq / 440.f) + 69;}
-
-class ScopeBuffer {
-public:
-  ScopeBuffer (int samprate) : sampleRate(samprate) {}
-
-  void writeSample (float sample) {
-    for (int i = 0; i < bufferSize - 1; i++) {
-      buffer[i] = buffer[i + 1];
-    }
-    buffer[bufferSize - 1] = sample;
+#include "Objects/Debug/RTSafety.cpp" // <- build with -DRT_SAFETY_CHECK to catch RT-unsafe calls
+#include "Objects/Debug/Trace.cpp" // <- build with -DDSP_TRACE for per-node timing
+#include "Objects/Control/PatchSnapshot.cpp"
+#include "Objects/Dynamics/Limiter.cpp"
+#include "Objects/IO/DiskRecorder.cpp"
+
+#include "Objects/Utility/AudioBlock.cpp"
+#include "Objects/Utility/SilenceGate.cpp"
+#include "Objects/Utility/FastMath.cpp" // <- dBtoA, ampTodB, mToF, fToM
+#include "Objects/Visualization/ScopeBuffer.cpp"
+#include "Objects/Synthesis/SinOsc.cpp"
+#include "Objects/Chains/GTRChain.cpp"
+
+#include "Objects/Synthesis/PolyphonyEngine.cpp"
+
+// everything onSound reads from the GUI, swapped in as one unit per block
+struct PatchState {
+  float volFactor = 1.f;
+  float pRatio = 1.f;
+  float distCoef = 1.f;
+  float tone = 0.5f; // <- 0..1, post-drive low-pass
+  int oscFreq = 1;
+  float filePlayback = 0.f; // <- 0 or 1, float so it can crossfade
+  float audioOutput = 0.f;
+
+  bool operator== (const PatchState& other) const {
+    return volFactor == other.volFactor && pRatio == other.pRatio &&
+      distCoef == other.distCoef && tone == other.tone && filePlayback == other.filePlayback &&
+      audioOutput == other.audioOutput && oscFreq == other.oscFreq;
   }
-
-  float readSample (int index) {
-    return buffer[index];
-  }
-    
-protected:
-  int sampleRate;
-  static const int bufferSize = 44100; // <- set equal to samplerate
-  float buffer[bufferSize];
-};
-
-
-class Phasor {
-public:
-  Phasor (int samprate) : sampleRate(samprate) {}
-
-  virtual void setSampleRate (int samprate) {
-    sampleRate = samprate;
-    phaseIncrement = frequency / static_cast<float> (sampleRate);
-  }
-
-  virtual void setFrequency (float freq) {
-    frequency = freq;
-    phaseIncrement = frequency / static_cast<float> (sampleRate);
-  }
-
-  virtual float processSample() {
-    float phaseIncrement = frequency / static_cast<float>(sampleRate);
-    phase += phaseIncrement;
-    phase = fmod(phase, 1.f);
-    return phase;
-  }
-
-  virtual float setPhase (float ph) {phase = ph;}
-  virtual float getPhase () {return phase;}
-
-protected:
-  float phase = 0.f;
-  int sampleRate = 44100;
-  float frequency = 1.f;
-  float phaseIncrement = frequency / static_cast<float>(sampleRate);
-};
-
-// sinOsc using Nth-order Taylor Series expansion, N adjustable
-// as seen in Gamma https://github.com/LancePutnam/Gamma 
-class SinOsc : public Phasor {
-public: 
-  SinOsc (int samprate) : 
-  Phasor(samprate) {}
-
-  float processSample() override {
-    phase += phaseIncrement;
-    phase = fmod(phase, 1.f);
-   return taylorNSin(
-    fmod(phase + (0.25f*(frequency-1.f)), 1.f) 
-    * twoPi - pi, 
-   N);
-  }
-
-  float setOrder (int order) {N = order;}
-
-protected:
-  int N = 11; // 11 is good
-  const float pi = static_cast<float>(M_PI);
-  const float twoPi = 2.f * pi;
-  const float nTwoPi = -1.f * twoPi;
-  int factorial (int x) {
-    int output = 1;
-    int n = x;
-    while (n > 1) {
-      output *= n;
-      n -= 1;
-    }
-    return output;
-  }
-
-  float taylorNSin (float x, int order) {
-    float output = x;
-    int n = 3;
-    int sign = -1;
-    while (n <= order) {
-     output += sign * (powf(x, n) / factorial(n));
-      sign *= -1;
-      n += 2;
-    }
-    return output;
-  }
-};
-
-template<typename T>
-class PolyphonyEngine {
-public:
-  PolyphonyEngine (int voices, int samprate) : 
-  numVoices(voices), sampleRate(samprate) {}
-
-  void prepare () {
-    for (int i = 0; i < numVoices; i++) {
-      oscBank.push_back(T (sampleRate));
-    }
-  }
-
-  void setFrequency(float freq) {
-    for (int i = 0; i < numVoices; i++) {
-      oscBank[i].setFrequency((i + 1) * freq);
-    }
-  }
-
-  float processSample() {
-    float output = 0.f;
-    for (int i = 0; i < numVoices; i++) {
-      output += oscBank[i].processSample();
-      if (i == 0) {
-        float diff = oscBank[i].getPhase() - last;
-        if (diff < 0) {
-          for (int j = 1; j < numVoices; j++) {
-            oscBank[j].setPhase(oscBank[i].getPhase());
-          }  
-        }
-      last = oscBank[i].getPhase();
-      }
-    }
-    return output * (1.f / numVoices); // <- should scale as a function of numVoices
-  }
-
-protected:
-  int type;
-  int numVoices;
-  int sampleRate;
-  float last;
-  std::vector<T> oscBank;
-};
-
-class PitchShift {
-public:
-  PitchShift (int samprate) : sampleRate(samprate) {}
-
-  void setPitchRatio (float ratio) {pitchRatio = ratio;}
-
-  float processSample(float input) {
-    float frequency = fabs(1000.f * ((1.f - pitchRatio) / windowSize));
-    float phaseIncrement = frequency / static_cast<float>(sampleRate);
-
-    if (pitchRatio < 1.f || pitchRatio > 1.f) { phase += phaseIncrement; } // up or down shifting
-    else { phase = 0.f; } // no shift 
-    phase = fmod(phase, 1.f);
-
-    float phaseTap = 0.f;
-    if (pitchRatio > 1.f) {phaseTap = 1 - phase;} // reverse sawtooth for up shifting  
-    else {phaseTap = phase;}
-
-    this->writeSample(input); // write sample to delay buffer
-
-    int readIndex = bufferSize - 1 - static_cast<int>(round( // readpoint 1
-        phaseTap * (windowSize * (sampleRate / 1000.f))
-        ));
-    int readIndex2 = bufferSize - 1 - static_cast<int>(round( // readpoint 2
-    (fmod(phaseTap + 0.5f, 1) * (windowSize * (sampleRate / 1000.f))
-    )));
-
-    float output = this->readSample(readIndex); // get sample
-    float output2 = this->readSample(readIndex2); // get sample 2
-    float windowOne = cosf((((phaseTap - 0.5f) / 2.f)) * 2.f * M_PI); // gain windowing 
-    float windowTwo = cosf(((fmod((phaseTap + 0.5f), 1.f) - 0.5f) / 2.f) * 2.f * M_PI);// // 
-
-    return output * windowOne + output2 * windowTwo; // windowed output
-  }
-
-  void writeSample (float sample) {
-    for (int i = 0; i < bufferSize - 1; i++) {
-      buffer[i] = buffer[i + 1];
-    }
-    buffer[bufferSize - 1] = sample;
-  }
-
-  float readSample (int index) {
-    return buffer[index];
-  }
-
-private:
-  static const int bufferSize = 96000;
-  float buffer[bufferSize];
-  int writeIndex;
-  int sampleRate;
-  float phase = 0.f;
-  float pitchRatio = 1.f;
-  float windowSize = 22.f; // make adjustable / calculate for optimized ratio? 
 };
 
 struct DSPTester : public App {
   Parameter volControl{"volControl", "", 0.f, -96.f, 6.f};
   Parameter rmsMeter{"rmsMeter", "", -96.f, -96.f, 0.f};
+  Parameter limiterGR{"limiterGR", "", 0.f, -24.f, 0.f}; // <- output limiter gain reduction
   Parameter pRatio{"pRatio", "", 1.f, 0.f, 2.f};
   Parameter distCoef{"distCoef", "", 1.f, 0.f, 1000.f};
+  Parameter tone{"tone", "", 0.5f, 0.f, 1.f};
   ParameterInt oscFreq{"oscFreq","", 1, 0, 127};
   ParameterBool audioOutput{"audioOutput", "", false, 0.f, 1.f};
   ParameterBool filePlayback{"filePlayback", "", false, 0.f, 1.f};
   gam::SamplePlayer<float, gam::ipl::Linear, gam::phsInc::Loop> player;
 
   ScopeBuffer scopeBuffer{static_cast<int>(AudioIO().framesPerSecond())};
+  vector<Limiter> limiters; // <- one per output channel
   Mesh oscScope{Mesh::LINE_STRIP};
-  PitchShift myShift{static_cast<int>(AudioIO().framesPerSecond())};
+  GTRChain gtr{static_cast<int>(AudioIO().framesPerSecond())}; // <- L dry drive, R shifted, aligned
+  SilenceGate inputGate; // <- skips the drive chain once input and tail are silent
+  SilenceGate outputGate; // <- skips the limiters on silent output
+  bool outputIdle = false; // <- nothing audible last block, scope already cleared
+  float currentTone = -1.f; // <- tone the filter was last designed for
+  int currentOscFreq = -1; // <- frequency osc was last tuned to, audio thread only
+  PatchSnapshot<PatchState> patch;
+  bool crossfadePatches = true; // <- fade old -> new state over one block
+  unique_ptr<DiskRecorder> recorder; // <- dry inputs then processed outputs
+  vector<float> recordBlock;
+  int takeNumber = 0;
 
   PolyphonyEngine<SinOsc> osc{5, static_cast<int>(AudioIO().framesPerSecond())};
   void onInit() {
+    // output protection, one limiter per output channel
+    for (int channel = 0; channel < audioIO().channelsOut(); channel++) {
+      limiters.emplace_back(static_cast<int>(audioIO().framesPerSecond()));
+    }
+
+    // background recorder, all memory allocated here
+    int recordChannels = audioIO().channelsIn() + audioIO().channelsOut();
+    recorder.reset(new DiskRecorder(recordChannels, static_cast<int>(audioIO().framesPerSecond())));
+    recordBlock.assign(audioIO().framesPerBuffer() * recordChannels, 0.f);
+
     // set up GUI
     auto GUIdomain = GUIDomain::enableGUI(defaultWindowDomain());
     auto &gui = GUIdomain->newGUI();
     gui.add(volControl); // add parameter to GUI
     gui.add(rmsMeter);
+    gui.add(limiterGR);
     gui.add(audioOutput); 
     gui.add(filePlayback); 
     gui.add(oscFreq);
     gui.add(pRatio);
     gui.add(distCoef);
+    gui.add(tone);
     
     //load file to player
     player.load("../Resources/clean.wav");
 
+    // report what the host sees: the aligned chain plus the limiter lookahead
+    float sampleRate = audioIO().framesPerSecond();
+    inputGate.setTailLength(gtr.getTailLength());
+    outputGate.setTailLength(limiters.empty() ? 0 : limiters[0].getTailLength());
+    int latency = gtr.getLatency() + (limiters.empty() ? 0 : limiters[0].getLatency());
+    cout << "Latency: " << latency << " samples (" << latency * 1000.f / sampleRate << " ms)" << endl;
+
     //prepare osc
     osc.prepare();
     osc.setFrequency(1.f);
@@ -258,7 +119,31 @@ struct DSPTester : public App {
     for (int i = 0; i < 44100; i++) {
       oscScope.vertices()[i][1] = scopeBuffer.readSample(i);
     }
-    osc.setFrequency(oscFreq); // <- optimzie with if(changed) architecture
+
+    // build the next patch state here, publish it with one pointer swap
+    PatchState next;
+    next.volFactor = dBtoA(volControl);
+    next.pRatio = pRatio;
+    next.distCoef = distCoef;
+    next.tone = tone;
+    next.oscFreq = oscFreq;
+    next.filePlayback = filePlayback ? 1.f : 0.f;
+    next.audioOutput = audioOutput ? 1.f : 0.f;
+    if (!(next == patch.getLatest())) {
+      patch.publish(std::unique_ptr<PatchState>(new PatchState(next)));
+    } else {
+      patch.collect();
+    }
+
+    RTSafety::report(); // print anything caught in onSound
+  }
+
+  void onExit() {
+    recorder->stop(); // <- finalize the header if a take is running
+#ifdef DSP_TRACE
+    Trace::printSummary();
+    Trace::writeChromeTrace("GTRPatch_trace.json"); // <- open in chrome://tracing
+#endif
   }
 
   bool onKeyDown(const Keyboard &k) override {
@@ -271,54 +156,133 @@ struct DSPTester : public App {
       player.reset();
       cout << "File Playback: " << filePlayback << endl; 
     }
+    if (k.key() == 'r') { // <- on r, start/stop recording
+      if (recorder->isRecording()) {
+        recorder->stop();
+        cout << "Recorded " << recorder->getFramesWritten() << " frames, dropped "
+          << recorder->getDroppedBlocks() << " blocks" << endl;
+      } else {
+        string path = "GTRPatch_take" + to_string(++takeNumber) + ".wav";
+        cout << (recorder->start(path.c_str()) ? "Recording to " : "Could not open ") << path << endl;
+      }
+    }
     return true;
   }
-  float last;
   void onSound(AudioIOData& io) override {
+    RTSafetyScope rtScope; // FTZ/DAZ; checked builds leave denormals on and count them per node
+    DSP_TRACE_BLOCK("onSound");
     // audio throughput
     float bufferPower = 0;
-    float volFactor = dBtoA(volControl);
-    myShift.setPitchRatio(pRatio);
+
+    // one patch state for the whole block, optionally faded from the last one
+    PatchSnapshot<PatchState>::Blocks states = patch.acquire();
+    const PatchState& to = *states.current;
+    const PatchState& from = (states.previous && crossfadePatches) ? *states.previous : to;
+    float fadeStep = (&from == &to) ? 0.f : 1.f / io.framesPerBuffer();
+    float fade = (&from == &to) ? 1.f : 0.f;
+    gtr.setPitchRatio(to.pRatio);
+    bool driveFades = from.distCoef != to.distCoef;
+    if (!driveFades) { gtr.setDrive(to.distCoef); } // <- else set per sample along the fade
+    if (to.tone != currentTone) { // <- redesign on change, the bank ramps the coefficients
+      gtr.setTone(to.tone, currentTone < 0.f);
+      currentTone = to.tone;
+      inputGate.setTailLength(gtr.getTailLength());
+    }
+    if (to.oscFreq != currentOscFreq) { // <- retune on change, with the rest of the patch
+      osc.setFrequency(to.oscFreq);
+      currentOscFreq = to.oscFreq;
+    }
+    int recordChannels = io.channelsIn() + io.channelsOut();
+    bool recording = recorder->isRecording() &&
+      static_cast<int>(recordBlock.size()) >= io.framesPerBuffer() * recordChannels;
+
+    // skip what can't be heard: the drive chain once its input has been
+    // silent longer than its tail, the synth while muted or faded out
+    bool chainRuns;
+    if (io.channelsIn() > 0) {
+      const float* input[1] = {io.inBuffer(0)};
+      chainRuns = inputGate.process(AudioBlock<const float>(input, 1, io.framesPerBuffer()));
+    } else {
+      chainRuns = inputGate.process(true, io.framesPerBuffer());
+    }
+    bool synthRuns = (from.audioOutput > 0.f || to.audioOutput > 0.f) &&
+      (from.filePlayback < 1.f || to.filePlayback < 1.f);
+    bool idle = !chainRuns && !synthRuns; // <- every output is zero this block
+
     while(io()) { 
+      fade += fadeStep;
+      float volFactor = from.volFactor + fade * (to.volFactor - from.volFactor);
+      float audioOutput = from.audioOutput + fade * (to.audioOutput - from.audioOutput);
+      float fileMix = from.filePlayback + fade * (to.filePlayback - from.filePlayback);
       //float outputL = player(0) * volFactor * audioOutput;
       
-      float outputL = 0.5f * ((atanf(io.in(0) * distCoef) / atanf(distCoef)) + last) / 2.f;
-      last = outputL;
-      float outputR = myShift.processSample(outputL);
+      float outputL = 0.f, outputR = 0.f;
+      if (chainRuns) {
+        DSP_TRACE_NODE("GTRChain");
+        if (driveFades) { gtr.setDrive(from.distCoef + fade * (to.distCoef - from.distCoef)); }
+        gtr.processSample(io.in(0), outputL, outputR);
+        RT_CHECK_SAMPLE("GTRChain", outputL);
+        RT_CHECK_SAMPLE("GTRChain", outputR);
+      }
       //float output = myShift.processSample(player(0)) * volFactor * audioOutput;
-      
-      if (filePlayback) {
-        for (int channel = 0; channel < io.channelsOut(); channel++) {
-          if (channel % 2 == 0) {
-            io.out(channel) = outputL;
-          } else {
-            io.out(channel) = outputR;
-          }
-        }
-      } else {
-        io.out(0) = osc.processSample() * volFactor * audioOutput;
-        io.out(1) = io.out(0);
+
+      float synth = 0.f; // <- only run the synth when it can be heard
+      if (synthRuns && fileMix < 1.f) {
+        DSP_TRACE_NODE("PolyphonyEngine");
+        synth = osc.processSample() * volFactor * audioOutput;
+        RT_CHECK_SAMPLE("PolyphonyEngine", synth);
+      }
+      for (int channel = 0; channel < io.channelsOut(); channel++) {
+        float fileOut = (channel % 2 == 0) ? outputL : outputR;
+        float synthOut = (channel < 2) ? synth : 0.f;
+        io.out(channel) = fileMix * fileOut + (1.f - fileMix) * synthOut;
       }
 
-      // feed to oscilliscope
-      if (filePlayback) {
-        scopeBuffer.writeSample((io.out(0) + io.out(1)));
-      } else {
-        //scopeBuffer.writeSample((io.out(0) + io.out(1)));
-        scopeBuffer.writeSample(io.out(0));
+      if (idle) { continue; } // <- scope cleared below, power stays 0
+
+      // feed to oscilliscope (L+R for file playback, L for synth)
+      {
+        DSP_TRACE_NODE("scope");
+        scopeBuffer.writeSample(io.out(0) + fileMix * io.out(1));
       }
 
       // feed to analysis buffer
-      for (int channel = 0; channel < io.channelsIn(); channel++){
-        bufferPower += powf(io.out(channel), 2);
+      {
+        DSP_TRACE_NODE("metering");
+        for (int channel = 0; channel < io.channelsIn(); channel++){
+          bufferPower += powf(io.out(channel), 2);
+        }
       }
-      // overload detector
-      if (io.out(0) > 1.f || io.out(1) > 1.f) {
-        cout << "CLIP!" << endl;
+    }
+
+    // whole-block stages run on AlloLib's planar buffers, no copies
+    float* outputs[AudioBlock<float>::maxChannels];
+    int outputChannels = min(io.channelsOut(), AudioBlock<float>::maxChannels);
+    for (int channel = 0; channel < outputChannels; channel++) { outputs[channel] = io.outBuffer(channel); }
+    AudioBlock<float> out(outputs, outputChannels, io.framesPerBuffer());
+    if (idle && !outputIdle) { scopeBuffer.clear(); }
+    outputIdle = idle;
+
+    // output protection: lookahead limiter on every channel, until its delay holds only silence
+    if (outputGate.process(out)) {
+      DSP_TRACE_NODE("Limiter");
+      for (int channel = 0; channel < static_cast<int>(limiters.size()) && channel < outputChannels; channel++) {
+        limiters[channel].processBlock(out.getChannel(channel), out.getChannel(channel), out.getNumSamples());
+      }
+    }
+    if (recording) {
+      for (int i = 0; i < out.getNumSamples(); i++) {
+        float* frame = recordBlock.data() + i * recordChannels;
+        for (int channel = 0; channel < io.channelsIn(); channel++) { *frame++ = io.inBuffer(channel)[i]; }
+        for (int channel = 0; channel < io.channelsOut(); channel++) { *frame++ = io.outBuffer(channel)[i]; }
       }
+      recorder->writeBlock(recordBlock.data(), io.framesPerBuffer());
     }
     bufferPower /= io.framesPerBuffer();
     rmsMeter = ampTodB(bufferPower);
+    float reduction = 0.f;
+    for (Limiter& limiter : limiters) { reduction = min(reduction, limiter.getGainReductiondB()); }
+    limiterGR = reduction;
   }
 
   void onDraw(Graphics &g) {
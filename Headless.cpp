@@ -0,0 +1,185 @@
+// Headless runner: the GTRPatch or PitchTest chain on an AudioBackend, with
+// no AlloLib window, GUI domain or hard-coded device names.
+//
+// usage: Headless [options]
+//   -b null|file|alsa  backend (default null)
+//   -c gtr|pitch       chain to run (default gtr)
+//   -i <in.wav>        input file, file backend
+//   -o <out.wav>       output file, file backend
+//   -D <pcm>           ALSA device, e.g. hw:0 (default "default")
+//   -r <rate>          sample rate (default 48000; file backend uses the file's)
+//   -n <frames>        block size (default 128)
+//   -s <seconds>       run time for null and alsa (default 10, 0 runs until killed)
+//   -p                 file backend: pace blocks in real time
+//   -d <coef>          drive coefficient for gtr (default 1)
+//   -t <tone>          tone 0..1 for gtr (default 0.5)
+//   -x <ratio>         pitch ratio (default 1)
+//
+// Prints the processing latency, blocks run, late blocks and the worst
+// callback load, and exits non-zero if the backend failed, e.g. the file
+// backend couldn't write its output. Chains whose input has been silent for longer than their
+// tail are skipped and output zeros; the summary counts those blocks.
+//
+// Build: cmake -S . -B build && cmake --build build --target Headless
+// (the alsa backend is compiled in when CMake finds libasound)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "Objects/IO/AudioBackend.cpp"
+#include "Objects/IO/AlsaBackend.cpp"
+#include "Objects/Chains/GTRChain.cpp"
+#include "Objects/Chains/PitchChain.cpp"
+#include "Objects/Dynamics/Limiter.cpp"
+#include "Objects/Utility/SilenceGate.cpp"
+
+struct Settings {
+  string backend = "null";
+  string chain = "gtr";
+  float drive = 1.f;
+  float tone = 0.5f;
+  float ratio = 1.f;
+};
+
+// the app chains behind the AudioProcessor interface, limiter on every output;
+// one gate for the gtr chain (mono in), one per channel for pitch
+struct ChainProcessor : public AudioProcessor {
+  Settings settings;
+  unique_ptr<GTRChain> gtr;
+  vector<unique_ptr<PitchChain>> pitch;
+  vector<Limiter> limiters;
+  vector<SilenceGate> gates;
+
+  ChainProcessor (const Settings& s) : settings(s) {}
+
+  void prepare (int samprate, int blockSize, int channelsIn, int channelsOut) override {
+    gtr.reset(new GTRChain(samprate));
+    gtr->setDrive(settings.drive);
+    gtr->setTone(settings.tone, true);
+    gtr->setPitchRatio(settings.ratio);
+    pitch.clear();
+    for (int ch = 0; ch < channelsOut; ch++) {
+      pitch.emplace_back(new PitchChain(samprate));
+      pitch[ch]->setPitchRatio(settings.ratio);
+    }
+    limiters.clear();
+    for (int ch = 0; ch < channelsOut; ch++) { limiters.emplace_back(samprate); }
+    int limiterTail = limiters.empty() ? 0 : limiters[0].getTailLength();
+    gates.clear();
+    if (settings.chain == "gtr") {
+      int tail = gtr->getTailLength();
+      gates.emplace_back(tail < 0 ? -1 : tail + limiterTail);
+    } else {
+      for (int ch = 0; ch < channelsOut; ch++) { gates.emplace_back(pitch[ch]->getTailLength() + limiterTail); }
+    }
+    silence.setSize(1, blockSize);
+    inputChannels = channelsIn;
+    outputChannels = channelsOut;
+  }
+
+  void process (AudioBlock<const float> inputs, AudioBlock<float> outputs) override {
+    int numFrames = outputs.getNumSamples();
+    AudioBlock<const float> source = inputChannels > 0 ? inputs : silence.getBlock(numFrames);
+    if (settings.chain == "gtr") {
+      if (!gates[0].process(source.getChannelRange(0, 1))) { outputs.clear(); return; }
+      gtr->processBlock(source, outputs); // <- first channel in, like io.in(0)
+      for (int ch = 0; ch < outputChannels; ch++) {
+        limiters[ch].processBlock(outputs.getChannel(ch), outputs.getChannel(ch), numFrames);
+      }
+    } else {
+      for (int ch = 0; ch < outputChannels; ch++) {
+        AudioBlock<const float> input = source.getChannelRange(ch % source.getNumChannels(), 1);
+        AudioBlock<float> output = outputs.getChannelRange(ch, 1);
+        if (!gates[ch].process(input)) { output.clear(); continue; }
+        pitch[ch]->processBlock(input.getChannel(0), output.getChannel(0), numFrames);
+        limiters[ch].processBlock(output.getChannel(0), output.getChannel(0), numFrames);
+      }
+    }
+  }
+
+  long long getBypassedBlocks () const {
+    long long total = 0;
+    for (const SilenceGate& gate : gates) { total += gate.getBypassedBlocks(); }
+    return total;
+  }
+
+  // chain plus the output limiter; the same on every channel
+  int getLatency () const override {
+    int chainLatency = settings.chain == "gtr" ? gtr->getLatency() : (pitch.empty() ? 0 : pitch[0]->getLatency());
+    return chainLatency + (limiters.empty() ? 0 : limiters[0].getLatency());
+  }
+
+  AudioBuffer<float> silence; // <- input when the backend has no capture channels
+  int inputChannels = 0;
+  int outputChannels = 0;
+};
+
+int main (int argc, char* argv[]) {
+  Settings settings;
+  AudioConfig config;
+  config.seconds = 10.0;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "-b" && hasValue) { settings.backend = argv[++i]; }
+    else if (arg == "-c" && hasValue) { settings.chain = argv[++i]; }
+    else if (arg == "-i" && hasValue) { config.inputPath = argv[++i]; }
+    else if (arg == "-o" && hasValue) { config.outputPath = argv[++i]; }
+    else if (arg == "-D" && hasValue) { config.device = argv[++i]; }
+    else if (arg == "-r" && hasValue) { config.sampleRate = atoi(argv[++i]); }
+    else if (arg == "-n" && hasValue) { config.blockSize = atoi(argv[++i]); }
+    else if (arg == "-s" && hasValue) { config.seconds = atof(argv[++i]); }
+    else if (arg == "-p") { config.realtime = true; }
+    else if (arg == "-d" && hasValue) { settings.drive = atof(argv[++i]); }
+    else if (arg == "-t" && hasValue) { settings.tone = atof(argv[++i]); }
+    else if (arg == "-x" && hasValue) { settings.ratio = atof(argv[++i]); }
+    else { settings.backend.clear(); break; }
+  }
+
+  unique_ptr<AudioBackend> backend;
+  if (settings.backend == "null") { backend.reset(new NullBackend()); }
+  else if (settings.backend == "file") { backend.reset(new FileBackend()); }
+  else if (settings.backend == "alsa") { backend.reset(new AlsaBackend()); }
+  if (!backend || (settings.chain != "gtr" && settings.chain != "pitch") || config.blockSize < 1 ||
+      (settings.backend == "file" && (config.inputPath.empty() || config.outputPath.empty()))) {
+    fprintf(stderr, "usage: %s [-b null|file|alsa] [-c gtr|pitch] [-i in.wav] [-o out.wav] [-D pcm] "
+      "[-r rate] [-n frames] [-s seconds] [-p] [-d drive] [-t tone] [-x ratio]\n", argv[0]);
+    return 1;
+  }
+
+  if (!backend->open(config)) {
+    fprintf(stderr, "%s backend: could not open %s\n", backend->name(),
+      settings.backend == "file" ? config.inputPath.c_str() : config.device.c_str());
+    return 1;
+  }
+  printf("%s backend: %d Hz, %d frames, %d in / %d out\n", backend->name(),
+    config.sampleRate, config.blockSize, config.channelsIn, config.channelsOut);
+
+  ChainProcessor processor(settings);
+  auto start = chrono::steady_clock::now();
+  backend->start(processor);
+  printf("latency: %d samples (%.2f ms) plus the device buffer\n", processor.getLatency(),
+    processor.getLatency() * 1000.0 / config.sampleRate);
+  double limit = settings.backend == "alsa" ? config.seconds : 0.0; // <- null and file stop themselves
+  while (backend->isRunning()) {
+    this_thread::sleep_for(chrono::milliseconds(50));
+    if (limit > 0.0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= limit) { break; }
+  }
+  backend->stop();
+  double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  printf("%lld blocks in %.2f s, %lld late, worst load %.1f%%\n", backend->getBlocks(), wallSeconds,
+    backend->getLateBlocks(), backend->getWorstLoad() * 100.0);
+  printf("%lld chain blocks bypassed on silence\n", processor.getBypassedBlocks());
+  if (backend->hasFailed()) {
+    fprintf(stderr, "%s backend failed: output incomplete\n", backend->name());
+    return 1;
+  }
+  return 0;
+}
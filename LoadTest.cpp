@@ -0,0 +1,353 @@
+// Load test: how many GTRPatch chains, PolyphonyEngine<SinOsc> synths,
+// stereo TimeStretch players or modulation effect racks one machine runs
+// inside a block deadline.
+//
+// usage: LoadTest [options]
+//   -c gtr|synth|stretch|fx|all  instance type (default all, ramped separately)
+//   -n <frames>        block size (default 128)
+//   -r <rate>          sample rate (default 48000)
+//   -j <cores>         most cores to test (default: all); runs 1, 2, 4 .. cores
+//   -s <seconds>       audio measured per step (default 2)
+//   -p <percentile>    block time percentile checked against the deadline (default 99)
+//
+// One thread per core, pinned, each running N independent instances back to
+// back per block on a plucked-string input (GTR), a note sequence (synth),
+// a stereo file at speeds from 0.5 to 1.5 (stretch) or the plucked input
+// through Chorus, Flanger, Echo and a Granulator in series (fx), like N
+// plugin instances in one callback. All cores run at once. N doubles
+// until the percentile block time passes the deadline (frames / rate), then
+// bisects. Reports the most instances per core that fit and the scaling
+// efficiency: instances per core on k cores over instances per core on one.
+//
+// Threads run flat out rather than paced, so the per-block times include
+// contention for shared caches and memory but not scheduling wakeups. Use
+// Headless for the real-time path.
+//
+// Build: cmake -S . -B build && cmake --build build --target LoadTest
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Objects/Chains/GTRChain.cpp"
+#include "Objects/Synthesis/PolyphonyEngine.cpp"
+#include "Objects/Synthesis/SinOsc.cpp"
+#include "Objects/Time-Domain/Granulator.cpp"
+#include "Objects/Time-Domain/ModulatedDelay.cpp"
+#include "Objects/Time-Domain/TimeStretch.cpp"
+#include "Objects/Utility/FastMath.cpp"
+
+struct Settings {
+  string type = "all";
+  int blockSize = 128;
+  int sampleRate = 48000;
+  int maxCores = 0;
+  double seconds = 2.0;
+  double percentile = 99.0;
+};
+
+// a few seconds of plucked notes: decaying harmonics plus pick noise
+static vector<float> makeGuitarInput (int sampleRate) {
+  vector<float> signal(4 * sampleRate, 0.f);
+  const int notes[] = {40, 45, 50, 55, 59, 64, 52, 47};
+  int noteLength = sampleRate / 2;
+  unsigned seed = 12345u;
+  for (int n = 0; n * noteLength < static_cast<int>(signal.size()); n++) {
+    float freq = mToF(notes[n % 8]);
+    for (int i = 0; i < noteLength && n * noteLength + i < static_cast<int>(signal.size()); i++) {
+      float t = static_cast<float>(i) / sampleRate;
+      float sample = 0.f;
+      for (int h = 1; h <= 8; h++) {
+        sample += expf(-t * 3.f * h) / h * sinf(2.f * static_cast<float>(M_PI) * freq * h * t);
+      }
+      seed = seed * 1664525u + 1013904223u;
+      float noise = (seed >> 9) * (2.f / 8388608.f) - 1.f;
+      signal[n * noteLength + i] = 0.4f * sample + 0.05f * noise * expf(-t * 200.f);
+    }
+  }
+  return signal;
+}
+
+// N instances of one type, processed back to back per block
+struct InstanceSet {
+  virtual ~InstanceSet () = default;
+  virtual void processBlock (int blockIndex) = 0;
+};
+
+struct GTRInstances : InstanceSet {
+  GTRInstances (int count, const Settings& s, const vector<float>& guitar) :
+  settings(s), input(guitar), left(s.blockSize), right(s.blockSize) {
+    for (int i = 0; i < count; i++) {
+      chains.emplace_back(new GTRChain(s.sampleRate));
+      chains[i]->setDrive(1.f + i % 5);
+      chains[i]->setPitchRatio(1.f + 0.1f * (i % 4));
+    }
+  }
+
+  void processBlock (int blockIndex) override {
+    int length = static_cast<int>(input.size());
+    int blocksPerSecond = settings.sampleRate / settings.blockSize;
+    for (int c = 0; c < static_cast<int>(chains.size()); c++) {
+      GTRChain& chain = *chains[c];
+      if ((blockIndex + c) % blocksPerSecond == 0) { // <- a tone move per second, smoothed by the bank
+        chain.setTone(0.5f + 0.4f * sinf(0.7f * (blockIndex / blocksPerSecond + c)));
+      }
+      int offset = (blockIndex * settings.blockSize + c * 997) % length; // <- each instance a different spot
+      for (int i = 0; i < settings.blockSize; i++) {
+        chain.processSample(input[(offset + i) % length], left[i], right[i]);
+      }
+    }
+  }
+
+  const Settings& settings;
+  const vector<float>& input;
+  vector<unique_ptr<GTRChain>> chains;
+  vector<float> left, right;
+};
+
+struct SynthInstances : InstanceSet {
+  SynthInstances (int count, const Settings& s) : settings(s), output(s.blockSize) {
+    for (int i = 0; i < count; i++) {
+      synths.emplace_back(new PolyphonyEngine<SinOsc>(5, s.sampleRate));
+      synths[i]->prepare();
+      synths[i]->setFrequency(mToF(48 + i % 12));
+    }
+  }
+
+  void processBlock (int blockIndex) override {
+    int blocksPerNote = max(1, settings.sampleRate / settings.blockSize / 4); // <- four notes a second
+    for (int v = 0; v < static_cast<int>(synths.size()); v++) {
+      PolyphonyEngine<SinOsc>& synth = *synths[v];
+      if ((blockIndex + v) % blocksPerNote == 0) { synth.setFrequency(mToF(48 + (blockIndex / blocksPerNote + v) % 24)); }
+      for (int i = 0; i < settings.blockSize; i++) { output[i] = synth.processSample(); }
+    }
+  }
+
+  const Settings& settings;
+  vector<unique_ptr<PolyphonyEngine<SinOsc>>> synths;
+  vector<float> output;
+};
+
+struct StretchInstances : InstanceSet {
+  StretchInstances (int count, const Settings& s, const vector<float>& guitar) :
+  settings(s), left(s.blockSize), right(s.blockSize) {
+    vector<float> stereo(2 * guitar.size());
+    for (size_t i = 0; i < guitar.size(); i++) { // <- right channel a quarter second behind
+      stereo[2 * i] = guitar[i];
+      stereo[2 * i + 1] = 0.8f * guitar[(i + guitar.size() - s.sampleRate / 4) % guitar.size()];
+    }
+    for (int i = 0; i < count; i++) {
+      players.emplace_back(new TimeStretch(s.sampleRate));
+      players[i]->load(stereo.data(), 2, static_cast<int>(guitar.size()));
+      players[i]->setLoop(true);
+      players[i]->setSpeed(0.5f + 0.25f * (i % 5)); // <- 0.5, 0.75, 1 (no search), 1.25, 1.5
+      players[i]->setPosition(i * 997.0);
+    }
+  }
+
+  void processBlock (int blockIndex) override {
+    (void)blockIndex;
+    float* channels[2] = {left.data(), right.data()};
+    AudioBlock<float> output(channels, 2, settings.blockSize);
+    for (unique_ptr<TimeStretch>& player : players) { player->processBlock(output); }
+  }
+
+  const Settings& settings;
+  vector<unique_ptr<TimeStretch>> players;
+  vector<float> left, right;
+};
+
+// one mono modulation rack: Chorus -> Flanger -> Echo -> Granulator
+struct FXInstances : InstanceSet {
+  struct Rack {
+    Rack (int sampleRate) : chorus(sampleRate), flanger(sampleRate), echo(sampleRate), grains(sampleRate, 1000.f) {
+      grains.setGrainSize(80.f);
+      grains.setDensity(200.f); // <- ~16 grains overlapping
+      grains.setPosition(100.f);
+      grains.setSpray(50.f);
+      grains.setPitchSpread(0.1f);
+    }
+    Chorus chorus;
+    Flanger flanger;
+    Echo echo;
+    Granulator grains;
+  };
+
+  FXInstances (int count, const Settings& s, const vector<float>& guitar) :
+  settings(s), input(guitar), dry(s.blockSize), wet(s.blockSize) {
+    for (int i = 0; i < count; i++) { racks.emplace_back(new Rack(s.sampleRate)); }
+  }
+
+  void processBlock (int blockIndex) override {
+    int length = static_cast<int>(input.size());
+    for (int r = 0; r < static_cast<int>(racks.size()); r++) {
+      Rack& rack = *racks[r];
+      int offset = (blockIndex * settings.blockSize + r * 997) % length; // <- each instance a different spot
+      for (int i = 0; i < settings.blockSize; i++) { dry[i] = input[(offset + i) % length]; }
+      rack.chorus.processBlock(dry.data(), wet.data(), settings.blockSize);
+      rack.flanger.processBlock(wet.data(), dry.data(), settings.blockSize);
+      rack.echo.processBlock(dry.data(), wet.data(), settings.blockSize);
+      rack.grains.processBlock(wet.data(), dry.data(), settings.blockSize);
+    }
+  }
+
+  const Settings& settings;
+  const vector<float>& input;
+  vector<unique_ptr<Rack>> racks;
+  vector<float> dry, wet;
+};
+
+static vector<int> availableCpus () {
+  vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) { cpus.push_back(cpu); }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    int count = max(1, static_cast<int>(thread::hardware_concurrency()));
+    for (int cpu = 0; cpu < count; cpu++) { cpus.push_back(cpu); }
+  }
+  return cpus;
+}
+
+static void pinToCpu (int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set); // <- best effort
+#else
+  (void)cpu;
+#endif
+}
+
+// runs perCore instances on each of the first numCores cpus at once,
+// returns the percentile block time in seconds over every core's blocks
+static double runStep (const Settings& settings, const string& type, int perCore, const vector<int>& cpus,
+  int numCores, const vector<float>& guitar) {
+  int warmupBlocks = settings.sampleRate / settings.blockSize / 4;
+  int measuredBlocks = max(16, static_cast<int>(settings.seconds * settings.sampleRate / settings.blockSize));
+  vector<vector<float>> times(numCores, vector<float>(measuredBlocks));
+  atomic<int> ready{0};
+  vector<thread> threads;
+  for (int core = 0; core < numCores; core++) {
+    threads.emplace_back([&, core] {
+      pinToCpu(cpus[core]);
+      unique_ptr<InstanceSet> instances; // <- built on the pinned thread, so memory is local to it
+      if (type == "gtr") { instances.reset(new GTRInstances(perCore, settings, guitar)); }
+      else if (type == "synth") { instances.reset(new SynthInstances(perCore, settings)); }
+      else if (type == "fx") { instances.reset(new FXInstances(perCore, settings, guitar)); }
+      else { instances.reset(new StretchInstances(perCore, settings, guitar)); }
+      ready++;
+      while (ready.load() < numCores) { this_thread::yield(); } // <- start together
+      for (int b = 0; b < warmupBlocks; b++) { instances->processBlock(b); }
+      for (int b = 0; b < measuredBlocks; b++) {
+        auto start = chrono::steady_clock::now();
+        instances->processBlock(warmupBlocks + b);
+        times[core][b] = chrono::duration<float>(chrono::steady_clock::now() - start).count();
+      }
+    });
+  }
+  for (thread& t : threads) { t.join(); }
+
+  vector<float> all;
+  for (const vector<float>& coreTimes : times) { all.insert(all.end(), coreTimes.begin(), coreTimes.end()); }
+  size_t rank = min(all.size() - 1, static_cast<size_t>(settings.percentile / 100.0 * all.size()));
+  nth_element(all.begin(), all.begin() + rank, all.end());
+  return all[rank];
+}
+
+// most instances per core whose percentile block time fits the deadline
+static int rampInstances (const Settings& settings, const string& type, const vector<int>& cpus, int numCores,
+  const vector<float>& guitar, double deadline) {
+  int passed = 0;
+  int failed = 0;
+  for (int n = 1; failed == 0; n *= 2) { // <- double until a step misses
+    double time = runStep(settings, type, n, cpus, numCores, guitar);
+    printf("  %d core(s) x %4d: p%g %7.1f us (%5.1f%% of deadline)\n", numCores, n, settings.percentile,
+      time * 1e6, 100.0 * time / deadline);
+    fflush(stdout);
+    if (time <= deadline) { passed = n; } else { failed = n; }
+  }
+  while (failed - passed > 1) { // <- then bisect
+    int n = (passed + failed) / 2;
+    double time = runStep(settings, type, n, cpus, numCores, guitar);
+    printf("  %d core(s) x %4d: p%g %7.1f us (%5.1f%% of deadline)\n", numCores, n, settings.percentile,
+      time * 1e6, 100.0 * time / deadline);
+    fflush(stdout);
+    if (time <= deadline) { passed = n; } else { failed = n; }
+  }
+  return passed;
+}
+
+int main (int argc, char* argv[]) {
+  Settings settings;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "-c" && hasValue) { settings.type = argv[++i]; }
+    else if (arg == "-n" && hasValue) { settings.blockSize = atoi(argv[++i]); }
+    else if (arg == "-r" && hasValue) { settings.sampleRate = atoi(argv[++i]); }
+    else if (arg == "-j" && hasValue) { settings.maxCores = atoi(argv[++i]); }
+    else if (arg == "-s" && hasValue) { settings.seconds = atof(argv[++i]); }
+    else if (arg == "-p" && hasValue) { settings.percentile = atof(argv[++i]); }
+    else {
+      fprintf(stderr, "usage: %s [-c gtr|synth|stretch|fx|all] [-n frames] [-r rate] [-j cores] [-s seconds]"
+        " [-p percentile]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (settings.type != "gtr" && settings.type != "synth" && settings.type != "stretch" && settings.type != "fx" &&
+      settings.type != "all") {
+    fprintf(stderr, "unknown instance type %s\n", settings.type.c_str());
+    return 1;
+  }
+  if (settings.blockSize < 1 || settings.sampleRate < settings.blockSize) {
+    fprintf(stderr, "bad block size or sample rate\n");
+    return 1;
+  }
+
+  vector<int> cpus = availableCpus();
+  int maxCores = settings.maxCores > 0 ? min(settings.maxCores, static_cast<int>(cpus.size())) : static_cast<int>(cpus.size());
+  vector<int> coreCounts;
+  for (int k = 1; k < maxCores; k *= 2) { coreCounts.push_back(k); }
+  coreCounts.push_back(maxCores);
+
+  double deadline = static_cast<double>(settings.blockSize) / settings.sampleRate;
+  printf("deadline %.1f us (%d frames at %d Hz), p%g, %zu cpu(s) available\n", deadline * 1e6,
+    settings.blockSize, settings.sampleRate, settings.percentile, cpus.size());
+  vector<float> guitar = makeGuitarInput(settings.sampleRate);
+
+  vector<string> types;
+  if (settings.type == "all") { types = {"gtr", "synth", "stretch", "fx"}; } else { types = {settings.type}; }
+  for (const string& type : types) {
+    printf("%s:\n", type == "gtr" ? "GTR chain (drive, smoothed tone, PitchShift)" :
+      (type == "synth" ? "PolyphonyEngine<SinOsc>, 5 voices" :
+      (type == "stretch" ? "TimeStretch, stereo, speeds 0.5 .. 1.5" : "Chorus, Flanger, Echo, Granulator, mono")));
+    vector<int> perCore;
+    for (int k : coreCounts) { perCore.push_back(rampInstances(settings, type, cpus, k, guitar, deadline)); }
+    printf("%8s %14s %10s %11s\n", "cores", "max per core", "total", "efficiency");
+    for (size_t i = 0; i < coreCounts.size(); i++) {
+      double efficiency = perCore[0] > 0 ? 100.0 * perCore[i] / perCore[0] : 0.0;
+      printf("%8d %14d %10d %10.0f%%\n", coreCounts[i], perCore[i], perCore[i] * coreCounts[i], efficiency);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+/*
+Implementation of the GTRPatch signal chain as a standalone object:
+high-pass, atan drive, tone low-pass, then PitchShift. Left is the dry
+drive, right is the shifted drive, same as the app. The left path is
+delayed by PitchShift's latency so both sides stay aligned.
+
+processBlock() takes the mono input as channel 0 of an AudioBlock and
+fills every output channel: even channels dry, odd channels shifted.
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include "../Time-Domain/PitchShift.cpp"
+#include "../Filters/BiquadBank.cpp"
+#include "../Time-Domain/LatencyCompensator.cpp"
+#include "../Utility/FastMath.cpp"
+#include "../Utility/AudioBlock.cpp"
+
+class GTRChain {
+public:
+  GTRChain (int samprate) : shifter(samprate), preDrive(samprate), toneFilter(samprate),
+  align(2, shifter.getLatency()), sampleRate(samprate) {
+    align.setPathLatency(1, shifter.getLatency());
+    preDrive.setStage(0, 0, BiquadCoefs::highPass(sampleRate, 90.f), true);
+    setTone(0.5f, true);
+  }
+
+  void setDrive (float coef) {
+    distCoef = coef;
+    driveNorm = coef > 0.f ? 1.f / atanf(coef) : 0.f;
+  }
+
+  void setPitchRatio (float ratio) {shifter.setPitchRatio(ratio);}
+
+  // 0..1, post-drive low-pass from 800 Hz to 12.8 kHz
+  void setTone (float tone, bool jump = false) {
+    float cutoff = 800.f * fastExp2(4.f * tone);
+    toneFilter.setStage(0, 0, BiquadCoefs::lowPass(sampleRate, cutoff), jump);
+  }
+
+  void processSample (float input, float& left, float& right) {
+    float tightened = preDrive.processSample(input);
+    float driven = distCoef > 0.f ? atanf(tightened * distCoef) * driveNorm : tightened; // <- atan(0x)/atan(0) -> x
+    float toned = toneFilter.processSample(driven);
+    left = align.processSample(0, toned);
+    right = align.processSample(1, shifter.processSample(toned));
+  }
+
+  void processBlock (AudioBlock<const float> input, AudioBlock<float> output) {
+    int channels = output.getNumChannels();
+    if (channels == 0) { return; }
+    const float* in = input.getChannel(0);
+    float* left = output.getChannel(0);
+    float* right = channels > 1 ? output.getChannel(1) : nullptr;
+    for (int i = 0; i < output.getNumSamples(); i++) {
+      float l, r;
+      processSample(in[i], l, r);
+      left[i] = l;
+      if (right != nullptr) { right[i] = r; }
+    }
+    AudioBlock<const float> pair = output.getChannelRange(0, channels < 2 ? channels : 2);
+    for (int ch = 2; ch < channels; ch += 2) { output.getChannelRange(ch, channels - ch).copyFrom(pair); }
+  }
+
+  int getLatency () const {return align.getLatency();}
+
+  // filters in series, then the longer of the two aligned paths; -1 if a filter rings forever
+  int getTailLength () const {
+    int filters = preDrive.getTailLength();
+    int tone = toneFilter.getTailLength();
+    if (filters < 0 || tone < 0) { return -1; }
+    int dry = align.getCompensation(0);
+    int shifted = shifter.getTailLength() + align.getCompensation(1);
+    return filters + tone + (dry > shifted ? dry : shifted);
+  }
+
+private:
+  PitchShift shifter;
+  BiquadBank<1> preDrive;
+  BiquadBank<1> toneFilter;
+  LatencyCompensator align; // <- path 0 dry, path 1 shifted
+  int sampleRate;
+  float distCoef = 1.f;
+  float driveNorm = 1.f / atanf(1.f);
+};
@@ -0,0 +1,36 @@
+/*
+Implementation of the PitchTest signal chain as a standalone object:
+PitchShift followed by a gain.
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include "../Time-Domain/PitchShift.cpp"
+#include "../Utility/FastMath.cpp"
+
+class PitchChain {
+public:
+  PitchChain (int samprate) : shifter(samprate) {}
+
+  void setPitchRatio (float ratio) {shifter.setPitchRatio(ratio);}
+  void setGain (float dB) {gain = dBtoA(dB);}
+
+  float processSample (float input) {
+    return shifter.processSample(input) * gain;
+  }
+
+  // in place is fine
+  void processBlock (const float* input, float* output, int numSamples) {
+    shifter.processBlock(input, output, numSamples);
+    for (int i = 0; i < numSamples; i++) { output[i] *= gain; }
+  }
+
+  int getLatency () const {return shifter.getLatency();}
+  int getTailLength () const {return shifter.getTailLength();}
+
+private:
+  PitchShift shifter;
+  float gain = 1.f;
+};
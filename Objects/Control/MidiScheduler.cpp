@@ -0,0 +1,117 @@
+/*
+Implementation of sample-accurate MIDI scheduling for block processing.
+
+Live input threads call push() with events stamped on the steady clock.
+The audio thread converts each stamp to a frame offset inside the current
+block, relative to the previous callback, so live events arrive exactly
+one block late with no jitter. Events from a loaded MIDI file are already
+in seconds from start and play against the running frame count.
+
+processBlock() splits the block at event boundaries: render(start, end)
+is called for each segment and onEvent(event) between segments, so a
+note starts on its exact frame at any buffer size.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../Utility/SPSCRing.cpp"
+
+struct MidiEvent {
+  double time = 0.0; // seconds, steady clock for live input or from file start
+  int offset = 0; // frame within the current block, set by the scheduler
+  unsigned char status = 0;
+  unsigned char data1 = 0;
+  unsigned char data2 = 0;
+
+  int type () const {return status & 0xF0;}
+  int channel () const {return status & 0x0F;}
+  bool isNoteOn () const {return type() == 0x90 && data2 > 0;}
+  bool isNoteOff () const {return type() == 0x80 || (type() == 0x90 && data2 == 0);}
+
+  static double now () {
+    return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+class MidiScheduler {
+public:
+  MidiScheduler (int samprate) : sampleRate(samprate), liveQueue(1024) {}
+
+  // any single non-audio thread: queue a live event
+  bool push (const MidiEvent& event) {return liveQueue.write(&event, 1) == 1;}
+
+  // control thread, while stopped: play a sorted event list from the next block
+  void setSequence (const std::vector<MidiEvent>* events) {
+    sequence = events;
+    sequenceIndex = 0;
+    sequenceStart = streamFrame;
+  }
+
+  template<typename Handler, typename Render>
+  void processBlock (int numFrames, Handler onEvent, Render render) {
+    double callbackTime = MidiEvent::now();
+    double blockStart = lastCallbackTime > 0.0 ? lastCallbackTime : callbackTime;
+    lastCallbackTime = callbackTime;
+    numPending = 0;
+
+    // live events: place relative to the previous callback, one block late
+    MidiEvent event;
+    while (numPending < maxPending && liveQueue.read(&event, 1) == 1) {
+      int offset = static_cast<int>((event.time - blockStart) * sampleRate);
+      event.offset = std::max(0, std::min(offset, numFrames - 1));
+      pending[numPending++] = event;
+    }
+
+    // file events that fall inside this block
+    if (sequence != nullptr) {
+      long long blockEnd = streamFrame + numFrames;
+      while (sequenceIndex < sequence->size() && numPending < maxPending) {
+        MidiEvent next = (*sequence)[sequenceIndex];
+        long long frame = sequenceStart + static_cast<long long>(next.time * sampleRate);
+        if (frame >= blockEnd) { break; }
+        next.offset = static_cast<int>(std::max(frame - streamFrame, 0LL));
+        pending[numPending++] = next;
+        sequenceIndex++;
+      }
+    }
+
+    for (int i = 1; i < numPending; i++) { // insertion sort, stable and allocation-free
+      MidiEvent key = pending[i];
+      int j = i - 1;
+      while (j >= 0 && pending[j].offset > key.offset) {
+        pending[j + 1] = pending[j];
+        j--;
+      }
+      pending[j + 1] = key;
+    }
+
+    int start = 0;
+    for (int i = 0; i < numPending; i++) {
+      if (pending[i].offset > start) {
+        render(start, pending[i].offset);
+        start = pending[i].offset;
+      }
+      onEvent(pending[i]);
+    }
+    if (start < numFrames) { render(start, numFrames); }
+    streamFrame += numFrames;
+  }
+
+private:
+  static const int maxPending = 256;
+  int sampleRate;
+  SPSCRing<MidiEvent> liveQueue;
+  MidiEvent pending[maxPending];
+  int numPending = 0;
+  double lastCallbackTime = 0.0;
+  long long streamFrame = 0;
+
+  const std::vector<MidiEvent>* sequence = nullptr;
+  size_t sequenceIndex = 0;
+  long long sequenceStart = 0;
+};
@@ -0,0 +1,258 @@
+/*
+Implementation of a modulation scheduler: LFOs and envelopes routed to
+target parameters, evaluated at control rate.
+
+Sources are evaluated once every controlInterval samples (16-64 is
+typical) at the end of the next segment, and each target ramps linearly
+toward its new value across the segment. A 5 Hz vibrato costs one sinf
+per 32 samples instead of an oscillator tick per sample. LFOs faster than
+the audio-rate threshold (FM, audio-rate AM) switch to per-sample
+evaluation and are added on top of the ramps, so they keep their
+waveform. Envelopes are linear ADSR segments, so interpolating them is
+exact; a gate change takes effect at the next segment boundary.
+
+processBlock() fills one buffer per target, read with getBlock(target)
+inside the sample loop:
+
+  mod.processBlock(io.framesPerBuffer());
+  const float* freq = mod.getBlock(pitchTarget);
+  while (io()) { osc.setFrequency(freq[io.frame()]); ... }
+
+A call covers at most getMaxBlockSize() samples (4096 by default) and
+returns how many it filled. Hosts with longer buffers refill in chunks,
+as DSP_Template does.
+
+Sources, targets and routes live in fixed pools, and the target buffers
+are allocated in the constructor. Configure them before audio starts;
+setters (frequency, base, depth, gate) are safe from the audio thread.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+class ModulationScheduler {
+public:
+  static const int maxSources = 16;
+  static const int maxTargets = 16;
+  static const int maxRoutes = 32;
+  enum Shape {SINE, TRIANGLE, SAW, SQUARE};
+
+  ModulationScheduler (int samprate, int controlInterval = 32, int maxBlockSize = 4096) :
+  sampleRate(samprate), interval(controlInterval < 1 ? 1 : controlInterval), maxBlock(maxBlockSize),
+  buffers(maxTargets * maxBlockSize, 0.f) {
+    setAudioRateThreshold(static_cast<float>(sampleRate) / interval / 16.f); // <- lerp error < 2% of depth
+  }
+
+  // sources; each returns an id, or -1 when the pool is full
+  int addLFO (float freq, Shape shape = SINE) {
+    if (numSources >= maxSources) { return -1; }
+    int s = numSources++;
+    sources[s] = Source();
+    sources[s].isLFO = true;
+    sources[s].shape = shape;
+    setFrequency(s, freq);
+    return s;
+  }
+
+  int addEnvelope (float attackMs, float decayMs, float sustain, float releaseMs) {
+    if (numSources >= maxSources) { return -1; }
+    int s = numSources++;
+    sources[s] = Source();
+    setEnvelope(s, attackMs, decayMs, sustain, releaseMs);
+    return s;
+  }
+
+  void setFrequency (int source, float hz) {
+    Source& src = sources[source];
+    src.frequency = hz;
+    src.increment = hz / sampleRate;
+    src.audioRate = src.isLFO && fabsf(hz) > audioRateThreshold;
+  }
+
+  void setEnvelope (int source, float attackMs, float decayMs, float sustain, float releaseMs) {
+    Source& src = sources[source];
+    src.attackStep = 1.f / samplesFor(attackMs);
+    src.sustain = sustain;
+    src.decayStep = (1.f - sustain) / samplesFor(decayMs);
+    src.releaseStep = 1.f / samplesFor(releaseMs); // <- full scale per release time
+  }
+
+  void gate (int source, bool on) {
+    Source& src = sources[source];
+    src.stage = on ? ATTACK : (src.stage == IDLE ? IDLE : RELEASE);
+  }
+
+  void setPhase (int source, float phase) {sources[source].phase = phase - floorf(phase);}
+
+  // targets: a base value plus the sum of depth x source over its routes
+  int addTarget (float value) {
+    if (numTargets >= maxTargets) { return -1; }
+    int t = numTargets++;
+    base[t] = value;
+    current[t] = value;
+    return t;
+  }
+
+  void setBase (int targetId, float value) {base[targetId] = value;}
+
+  // returns a route id, or -1 when the pool is full
+  int connect (int source, int targetId, float depth) {
+    if (numRoutes >= maxRoutes || source < 0 || targetId < 0) { return -1; }
+    routes[numRoutes] = {source, targetId, depth};
+    return numRoutes++;
+  }
+
+  void setDepth (int route, float depth) {routes[route].depth = depth;}
+
+  // LFOs above this run per sample; default is controlRate / 16
+  void setAudioRateThreshold (float hz) {
+    audioRateThreshold = hz;
+    for (int s = 0; s < numSources; s++) { setFrequency(s, sources[s].frequency); }
+  }
+
+  // fills at most getMaxBlockSize() samples and returns how many; call again for the rest
+  int processBlock (int numSamples) {
+    if (numSamples > maxBlock) { numSamples = maxBlock; } // <- buffers are sized in the constructor
+    for (int i = 0; i < numSamples;) {
+      if (segmentRemaining == 0) { startSegment(); }
+      int n = segmentRemaining < numSamples - i ? segmentRemaining : numSamples - i;
+      for (int t = 0; t < numTargets; t++) {
+        float* out = buffers.data() + t * maxBlock + i;
+        float value = current[t];
+        float s = step[t];
+        for (int k = 0; k < n; k++) { out[k] = value + s * (k + 1); }
+        current[t] = value + s * n;
+      }
+      segmentRemaining -= n;
+      i += n;
+    }
+
+    // audio-rate LFOs on top of the ramps
+    for (int s = 0; s < numSources; s++) {
+      Source& src = sources[s];
+      if (!src.audioRate) { continue; }
+      for (int r = 0; r < numRoutes; r++) {
+        if (routes[r].source != s) { continue; }
+        float* out = buffers.data() + routes[r].target * maxBlock;
+        float depth = routes[r].depth;
+        float phase = src.phase;
+        for (int i = 0; i < numSamples; i++) {
+          phase += src.increment;
+          phase -= floorf(phase);
+          out[i] += depth * lfo(src.shape, phase);
+        }
+      }
+      src.phase += src.increment * numSamples;
+      src.phase -= floorf(src.phase);
+    }
+    return numSamples;
+  }
+
+  const float* getBlock (int targetId) const {return buffers.data() + targetId * maxBlock;}
+  float getValue (int targetId) const {return current[targetId];} // <- control-rate part, end of the last block
+  int getMaxBlockSize () const {return maxBlock;}
+  int getControlInterval () const {return interval;}
+  bool isAudioRate (int source) const {return sources[source].audioRate;}
+
+private:
+  enum Stage {IDLE, ATTACK, DECAY, SUSTAIN, RELEASE};
+
+  struct Source {
+    bool isLFO = false;
+    bool audioRate = false;
+    Shape shape = SINE;
+    float frequency = 0.f;
+    float increment = 0.f;
+    float phase = 0.f;
+    float value = 0.f; // <- envelope level
+    Stage stage = IDLE;
+    float attackStep = 1.f;
+    float decayStep = 1.f;
+    float sustain = 1.f;
+    float releaseStep = 1.f;
+  };
+
+  struct Route {
+    int source;
+    int target;
+    float depth;
+  };
+
+  float samplesFor (float ms) const {
+    float samples = ms * sampleRate / 1000.f;
+    return samples < 1.f ? 1.f : samples;
+  }
+
+  static float lfo (Shape shape, float phase) {
+    if (shape == SINE) { return sinf(2.f * static_cast<float>(M_PI) * phase); }
+    if (shape == TRIANGLE) { return phase < 0.5f ? 4.f * phase - 1.f : 3.f - 4.f * phase; }
+    if (shape == SAW) { return 2.f * phase - 1.f; }
+    return phase < 0.5f ? 1.f : -1.f;
+  }
+
+  // advances a control-rate source to the end of the next segment
+  float advance (Source& src, int samples) {
+    if (src.isLFO) {
+      src.phase += src.increment * samples;
+      src.phase -= floorf(src.phase);
+      return lfo(src.shape, src.phase);
+    }
+    float remaining = static_cast<float>(samples);
+    while (remaining > 0.f) {
+      if (src.stage == ATTACK) {
+        float needed = (1.f - src.value) / src.attackStep;
+        if (needed > remaining) { src.value += src.attackStep * remaining; break; }
+        src.value = 1.f;
+        remaining -= needed;
+        src.stage = DECAY;
+      } else if (src.stage == DECAY) {
+        float needed = (src.value - src.sustain) / src.decayStep;
+        if (needed > remaining) { src.value -= src.decayStep * remaining; break; }
+        src.value = src.sustain;
+        src.stage = SUSTAIN;
+        break;
+      } else if (src.stage == RELEASE) {
+        float needed = src.value / src.releaseStep;
+        if (needed > remaining) { src.value -= src.releaseStep * remaining; break; }
+        src.value = 0.f;
+        src.stage = IDLE;
+        break;
+      } else {
+        break; // <- sustain and idle hold
+      }
+    }
+    return src.value;
+  }
+
+  void startSegment () {
+    for (int s = 0; s < numSources; s++) {
+      sourceValue[s] = sources[s].audioRate ? 0.f : advance(sources[s], interval);
+    }
+    for (int t = 0; t < numTargets; t++) { target[t] = base[t]; }
+    for (int r = 0; r < numRoutes; r++) {
+      target[routes[r].target] += routes[r].depth * sourceValue[routes[r].source];
+    }
+    for (int t = 0; t < numTargets; t++) { step[t] = (target[t] - current[t]) / interval; }
+    segmentRemaining = interval;
+  }
+
+  int sampleRate;
+  int interval;
+  int maxBlock;
+  float audioRateThreshold = 0.f;
+  int segmentRemaining = 0;
+  std::vector<float> buffers; // <- maxTargets x maxBlock
+
+  int numSources = 0;
+  int numTargets = 0;
+  int numRoutes = 0;
+  Source sources[maxSources];
+  Route routes[maxRoutes] = {};
+  float sourceValue[maxSources] = {};
+  float base[maxTargets] = {};
+  float current[maxTargets] = {};
+  float target[maxTargets] = {};
+  float step[maxTargets] = {};
+};
@@ -0,0 +1,84 @@
+/*
+Implementation of whole-patch state swapping between threads.
+
+The control thread builds a complete State off the audio thread and
+publishes it with one atomic pointer store. At the top of each callback
+the audio thread calls acquire(), which returns the state to use for the
+whole block (plus the one it replaced, for an optional one-block
+crossfade). A patch change is therefore never applied halfway through.
+
+States are never freed on the audio thread. The audio thread protects
+the states it holds with two hazard pointers, and the control thread
+frees retired states in collect() (called from publish(), or from
+onAnimate) once neither hazard points at them.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+template<typename State>
+class PatchSnapshot {
+public:
+  struct Blocks {
+    const State* current; // <- state for this block
+    const State* previous; // <- state it replaced this block, or nullptr
+  };
+
+  PatchSnapshot (const State& initial = State()) {
+    publish(std::unique_ptr<State>(new State(initial)));
+  }
+
+  // control thread: hand over a fully built state
+  void publish (std::unique_ptr<State> next) {
+    State* raw = next.get();
+    owned.push_back(std::move(next));
+    latest.store(raw);
+    collect();
+  }
+
+  // control thread: free states the audio thread can no longer see
+  void collect () {
+    State* keepLatest = latest.load();
+    State* keepCurrent = hazardCurrent.load();
+    State* keepPrevious = hazardPrevious.load();
+    for (size_t i = 0; i < owned.size();) {
+      State* s = owned[i].get();
+      if (s != keepLatest && s != keepCurrent && s != keepPrevious) {
+        owned[i] = std::move(owned.back());
+        owned.pop_back();
+      } else {
+        i++;
+      }
+    }
+  }
+
+  // control thread: most recently published state, for building the next one
+  const State& getLatest () const {return *latest.load();}
+
+  // audio thread: once per block, O(1) unless the control thread is mid-publish
+  Blocks acquire () {
+    State* seen = latest.load();
+    if (seen == current) {
+      hazardPrevious.store(nullptr);
+      return Blocks{current, nullptr};
+    }
+    hazardPrevious.store(current); // <- keep the old state alive for a crossfade
+    do { // hazard protocol: the pointer we publish must still be latest
+      seen = latest.load();
+      hazardCurrent.store(seen);
+    } while (seen != latest.load());
+    const State* previous = current;
+    current = seen;
+    return Blocks{current, previous};
+  }
+
+private:
+  std::vector<std::unique_ptr<State>> owned; // <- control thread only
+  std::atomic<State*> latest{nullptr};
+  std::atomic<State*> hazardCurrent{nullptr};
+  std::atomic<State*> hazardPrevious{nullptr};
+  State* current = nullptr; // <- audio thread only
+};
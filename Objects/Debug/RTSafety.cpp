@@ -0,0 +1,338 @@
+/*
+Real-time safety checker for audio callbacks.
+
+Place an RTSafetyScope at the top of onSound (or around any offline-driven
+process call). The scope enables flush-to-zero / denormals-are-zero for its
+lifetime, except in RT_SAFETY_CHECK builds: there it leaves FTZ/DAZ off by
+default, so nodes that produce denormals actually produce them and
+RT_CHECK_SAMPLE can count them. Pass true to flush anyway. When compiled
+with -DRT_SAFETY_CHECK, malloc/free, mutex locks and file I/O are also
+interposed, and any such call made on a thread that holds a scope is
+reported to stderr with a stack trace.
+
+RT_CHECK_SAMPLE(node, x) counts NaN, Inf and denormal samples per node.
+Counts are kept in atomics so the audio thread never prints; call
+RTSafety::report() from onAnimate (or any non-audio thread) to print them.
+Without RT_SAFETY_CHECK the macro compiles to nothing.
+
+Include this file in exactly one translation unit per app.
+
+TO-DO:
+-interpose on Windows
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#ifdef RT_SAFETY_CHECK
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <unistd.h>
+#endif
+
+class RTSafety {
+public:
+  // per-node counters for bad samples
+  struct NodeStats {
+    const char* name = nullptr;
+    std::atomic<unsigned> nans{0};
+    std::atomic<unsigned> infs{0};
+    std::atomic<unsigned> denormals{0};
+  };
+
+  static const int maxNodes = 64;
+  static const int maxReportedViolations = 16; // <- full traces, then count only
+
+  static int registerNode (const char* name) {
+    int n = numNodes().load();
+    for (int i = 0; i < n && i < maxNodes; i++) { // <- call sites share a node by name
+      if (nodes()[i].name != nullptr && strcmp(nodes()[i].name, name) == 0) { return i; }
+    }
+    int id = numNodes().fetch_add(1);
+    if (id >= maxNodes) { return maxNodes - 1; } // <- share last slot on overflow
+    nodes()[id].name = name;
+    return id;
+  }
+
+  static void checkSample (int node, float x) {
+    // classify by bits, since DAZ makes float compares see denormals as zero
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    uint32_t exponent = bits & 0x7f800000u;
+    uint32_t mantissa = bits & 0x007fffffu;
+    if (exponent == 0x7f800000u) {
+      if (mantissa) { nodes()[node].nans.fetch_add(1, std::memory_order_relaxed); }
+      else { nodes()[node].infs.fetch_add(1, std::memory_order_relaxed); }
+    } else if (exponent == 0 && mantissa) {
+      nodes()[node].denormals.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static void checkBlock (int node, const float* block, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      checkSample(node, block[i]);
+    }
+  }
+
+  // called by the interposed functions while a scope is active
+  static void violation (const char* what) {
+    reporting() = true; // <- lets our own write()/backtrace() through
+    unsigned count = violations().fetch_add(1) + 1;
+    if (count <= maxReportedViolations) {
+      char message[128];
+      int length = snprintf(message, sizeof(message),
+        "RT VIOLATION #%u: %s called inside audio callback\n", count, what);
+      ::fwrite(message, 1, length, stderr);
+#ifdef RT_SAFETY_CHECK
+      void* frames[32];
+      int numFrames = backtrace(frames, 32);
+      backtrace_symbols_fd(frames, numFrames, fileno(stderr));
+#endif
+    }
+    reporting() = false;
+  }
+
+  // print and reset counters; never call from the audio thread
+  static void report () {
+    unsigned count = violations().exchange(0);
+    if (count > 0) {
+      fprintf(stderr, "RTSafety: %u violation(s) since last report\n", count);
+    }
+    int n = numNodes().load();
+    if (n > maxNodes) { n = maxNodes; }
+    for (int i = 0; i < n; i++) {
+      unsigned nans = nodes()[i].nans.exchange(0);
+      unsigned infs = nodes()[i].infs.exchange(0);
+      unsigned denormals = nodes()[i].denormals.exchange(0);
+      if (nans + infs + denormals > 0) {
+        fprintf(stderr, "RTSafety: %s produced %u NaN, %u Inf, %u denormal sample(s)\n",
+          nodes()[i].name, nans, infs, denormals);
+      }
+    }
+  }
+
+  static bool& inScope () { static thread_local bool flag = false; return flag; }
+  static bool& reporting () { static thread_local bool flag = false; return flag; }
+  static bool shouldReport () { return inScope() && !reporting(); }
+
+private:
+  static NodeStats* nodes () { static NodeStats stats[maxNodes]; return stats; }
+  static std::atomic<int>& numNodes () { static std::atomic<int> n{0}; return n; }
+  static std::atomic<unsigned>& violations () { static std::atomic<unsigned> n{0}; return n; }
+};
+
+// RAII guard marking the current thread as real-time
+class RTSafetyScope {
+public:
+#ifdef RT_SAFETY_CHECK
+  static const bool flushByDefault = false; // <- denormals stay visible to RT_CHECK_SAMPLE
+#else
+  static const bool flushByDefault = true;
+#endif
+
+  RTSafetyScope (bool flushDenormals = flushByDefault) {
+#if defined(__SSE__) || defined(_M_X64)
+    savedCSR = _mm_getcsr();
+    if (flushDenormals) { _mm_setcsr(savedCSR | 0x8040); } // <- FTZ (bit 15) | DAZ (bit 6)
+#elif defined(__aarch64__)
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(savedCSR));
+    if (flushDenormals) {
+      unsigned long fz = savedCSR | (1ul << 24); // <- FZ bit
+      __asm__ __volatile__("msr fpcr, %0" : : "r"(fz));
+    }
+#endif
+    wasInScope = RTSafety::inScope();
+    RTSafety::inScope() = true;
+  }
+
+  ~RTSafetyScope () {
+    RTSafety::inScope() = wasInScope;
+#if defined(__SSE__) || defined(_M_X64)
+    _mm_setcsr(savedCSR);
+#elif defined(__aarch64__)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(savedCSR));
+#endif
+  }
+
+  RTSafetyScope (const RTSafetyScope&) = delete;
+  RTSafetyScope& operator= (const RTSafetyScope&) = delete;
+
+private:
+  unsigned long savedCSR = 0;
+  bool wasInScope = false;
+};
+
+#ifdef RT_SAFETY_CHECK
+
+#define RT_CHECK_SAMPLE(node, x) do { \
+  static const int rtNodeId = RTSafety::registerNode(node); \
+  RTSafety::checkSample(rtNodeId, (x)); } while (0)
+
+#define RT_CHECK_BLOCK(node, block, n) do { \
+  static const int rtNodeId = RTSafety::registerNode(node); \
+  RTSafety::checkBlock(rtNodeId, (block), (n)); } while (0)
+
+// prime backtrace() so its first call doesn't allocate inside a callback
+static const int rtSafetyPrimed = [] { void* frame[1]; return backtrace(frame, 1); }();
+
+#if defined(__linux__)
+
+// glibc exports its allocator under these names, so no dlsym is needed
+extern "C" void* __libc_malloc (size_t);
+extern "C" void* __libc_calloc (size_t, size_t);
+extern "C" void* __libc_realloc (void*, size_t);
+extern "C" void __libc_free (void*);
+
+template<typename F>
+static F rtNext (const char* symbol) { return reinterpret_cast<F>(dlsym(RTLD_NEXT, symbol)); }
+
+extern "C" {
+void* malloc (size_t size) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("malloc"); }
+  return __libc_malloc(size);
+}
+
+void* calloc (size_t count, size_t size) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("calloc"); }
+  return __libc_calloc(count, size);
+}
+
+void* realloc (void* ptr, size_t size) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("realloc"); }
+  return __libc_realloc(ptr, size);
+}
+
+void free (void* ptr) {
+  if (ptr != nullptr && RTSafety::shouldReport()) { RTSafety::violation("free"); }
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock (pthread_mutex_t* mutex) {
+  static auto next = rtNext<int (*)(pthread_mutex_t*)>("pthread_mutex_lock");
+  if (RTSafety::shouldReport()) { RTSafety::violation("pthread_mutex_lock"); }
+  return next(mutex);
+}
+
+FILE* fopen (const char* path, const char* mode) {
+  static auto next = rtNext<FILE* (*)(const char*, const char*)>("fopen");
+  if (RTSafety::shouldReport()) { RTSafety::violation("fopen"); }
+  return next(path, mode);
+}
+
+size_t fread (void* ptr, size_t size, size_t count, FILE* file) {
+  static auto next = rtNext<size_t (*)(void*, size_t, size_t, FILE*)>("fread");
+  if (RTSafety::shouldReport()) { RTSafety::violation("fread"); }
+  return next(ptr, size, count, file);
+}
+
+size_t fwrite (const void* ptr, size_t size, size_t count, FILE* file) {
+  static auto next = rtNext<size_t (*)(const void*, size_t, size_t, FILE*)>("fwrite");
+  if (RTSafety::shouldReport()) { RTSafety::violation("fwrite"); }
+  return next(ptr, size, count, file);
+}
+
+int open (const char* path, int flags, ...) {
+  static auto next = rtNext<int (*)(const char*, int, ...)>("open");
+  if (RTSafety::shouldReport()) { RTSafety::violation("open"); }
+  mode_t mode = 0;
+  if (flags & O_CREAT) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, int);
+    va_end(args);
+  }
+  return next(path, flags, mode);
+}
+
+ssize_t read (int fd, void* buffer, size_t count) {
+  static auto next = rtNext<ssize_t (*)(int, void*, size_t)>("read");
+  if (RTSafety::shouldReport()) { RTSafety::violation("read"); }
+  return next(fd, buffer, count);
+}
+
+ssize_t write (int fd, const void* buffer, size_t count) { // <- catches cout flushes
+  static auto next = rtNext<ssize_t (*)(int, const void*, size_t)>("write");
+  if (RTSafety::shouldReport()) { RTSafety::violation("write"); }
+  return next(fd, buffer, count);
+}
+}
+
+#elif defined(__APPLE__)
+
+// dyld interposition: each entry replaces the second function with the first
+#define RT_INTERPOSE(replacement, original) \
+  __attribute__((used)) static struct { const void* r; const void* o; } \
+  rtInterpose_##original __attribute__((section("__DATA,__interpose"))) = \
+  { (const void*)(unsigned long)&replacement, (const void*)(unsigned long)&original };
+
+static void* rtMalloc (size_t size) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("malloc"); }
+  return malloc(size);
+}
+static void* rtCalloc (size_t count, size_t size) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("calloc"); }
+  return calloc(count, size);
+}
+static void* rtRealloc (void* ptr, size_t size) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("realloc"); }
+  return realloc(ptr, size);
+}
+static void rtFree (void* ptr) {
+  if (ptr != nullptr && RTSafety::shouldReport()) { RTSafety::violation("free"); }
+  free(ptr);
+}
+static int rtMutexLock (pthread_mutex_t* mutex) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("pthread_mutex_lock"); }
+  return pthread_mutex_lock(mutex);
+}
+static FILE* rtFopen (const char* path, const char* mode) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("fopen"); }
+  return fopen(path, mode);
+}
+static size_t rtFread (void* ptr, size_t size, size_t count, FILE* file) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("fread"); }
+  return fread(ptr, size, count, file);
+}
+static size_t rtFwrite (const void* ptr, size_t size, size_t count, FILE* file) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("fwrite"); }
+  return fwrite(ptr, size, count, file);
+}
+static ssize_t rtRead (int fd, void* buffer, size_t count) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("read"); }
+  return read(fd, buffer, count);
+}
+static ssize_t rtWrite (int fd, const void* buffer, size_t count) {
+  if (RTSafety::shouldReport()) { RTSafety::violation("write"); }
+  return write(fd, buffer, count);
+}
+
+RT_INTERPOSE(rtMalloc, malloc)
+RT_INTERPOSE(rtCalloc, calloc)
+RT_INTERPOSE(rtRealloc, realloc)
+RT_INTERPOSE(rtFree, free)
+RT_INTERPOSE(rtMutexLock, pthread_mutex_lock)
+RT_INTERPOSE(rtFopen, fopen)
+RT_INTERPOSE(rtFread, fread)
+RT_INTERPOSE(rtFwrite, fwrite)
+RT_INTERPOSE(rtRead, read)
+RT_INTERPOSE(rtWrite, write)
+
+#endif // platform
+
+#else
+
+#define RT_CHECK_SAMPLE(node, x) do {} while (0)
+#define RT_CHECK_BLOCK(node, block, n) do {} while (0)
+
+#endif // RT_SAFETY_CHECK
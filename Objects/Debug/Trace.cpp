@@ -0,0 +1,224 @@
+/*
+Lightweight per-node timing for audio callbacks.
+
+DSP_TRACE_BLOCK(name) goes at the top of onSound. DSP_TRACE_NODE(name)
+goes around a DSP object's work, even inside the sample loop. Node time
+is summed within the block, and when the block scope closes it records
+one event for the block and one per node. Events go into a per-thread
+ring that is claimed from a static pool, so recording never allocates
+or locks.
+
+Time is read with rdtsc on x86 and the steady clock elsewhere.
+Trace::writeChromeTrace(path) writes JSON for chrome://tracing or
+Perfetto. Trace::printSummary() prints mean/max per node per block.
+Export after audio has stopped (e.g. in onExit); rings are overwritten
+when full.
+
+Everything compiles to nothing unless DSP_TRACE is defined.
+*/
+
+#pragma once
+
+#ifdef DSP_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+class Trace {
+public:
+  static const int maxNodes = 64;
+  static const int maxThreads = 16;
+  static const int ringSize = 1 << 16; // <- events per thread
+
+  struct Event {
+    int node; // <- -1 for the block itself
+    uint64_t start;
+    uint64_t duration;
+  };
+
+  static uint64_t now () {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  static int nodeId (const char* name) {
+    int n = numNodes().load();
+    for (int i = 0; i < n && i < maxNodes; i++) {
+      if (strcmp(nodeNames()[i], name) == 0) { return i; }
+    }
+    int id = numNodes().fetch_add(1);
+    if (id >= maxNodes) { return maxNodes - 1; }
+    nodeNames()[id] = name;
+    return id;
+  }
+
+  // per-thread state: ring slot plus this block's accumulators
+  struct ThreadState {
+    Event* ring = nullptr;
+    std::atomic<uint64_t>* count = nullptr;
+    const char* blockName = nullptr;
+    uint64_t blockStart = 0;
+    uint64_t nodeTicks[maxNodes] = {};
+    bool nodeUsed[maxNodes] = {};
+  };
+
+  static ThreadState& thread () {
+    static thread_local ThreadState state;
+    if (state.ring == nullptr) { // <- claim a ring from the static pool, no allocation
+      int slot = numThreads().fetch_add(1);
+      if (slot >= maxThreads) { slot = maxThreads - 1; }
+      state.ring = rings()[slot];
+      state.count = &counts()[slot];
+      threadIds()[slot] = std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000;
+    }
+    return state;
+  }
+
+  static void record (ThreadState& state, int node, uint64_t start, uint64_t duration) {
+    uint64_t n = state.count->load(std::memory_order_relaxed);
+    state.ring[n & (ringSize - 1)] = Event{node, start, duration};
+    state.count->store(n + 1, std::memory_order_release);
+  }
+
+  static void beginBlock (const char* name) {
+    ThreadState& state = thread();
+    state.blockName = name;
+    state.blockStart = now();
+  }
+
+  static void endBlock () {
+    ThreadState& state = thread();
+    uint64_t end = now();
+    record(state, -1, state.blockStart, end - state.blockStart);
+    blockName() = state.blockName;
+    uint64_t offset = state.blockStart;
+    for (int i = 0; i < maxNodes; i++) { // <- nodes laid end to end inside the block
+      if (!state.nodeUsed[i]) { continue; }
+      record(state, i, offset, state.nodeTicks[i]);
+      offset += state.nodeTicks[i];
+      state.nodeTicks[i] = 0;
+      state.nodeUsed[i] = false;
+    }
+  }
+
+  static void writeChromeTrace (const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) { return; }
+    double ticksPerMicro = calibrate();
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    forEachEvent([&](int thread, const Event& e) {
+      const char* name = e.node < 0 ? (blockName() ? blockName() : "block") : nodeNames()[e.node];
+      fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+        first ? "" : ",\n", name, threadIds()[thread],
+        e.start / ticksPerMicro, e.duration / ticksPerMicro);
+      first = false;
+    });
+    fprintf(file, "\n]}\n");
+    fclose(file);
+  }
+
+  static void printSummary () {
+    double ticksPerMicro = calibrate();
+    uint64_t total[maxNodes + 1] = {};
+    uint64_t worst[maxNodes + 1] = {};
+    uint64_t count[maxNodes + 1] = {};
+    forEachEvent([&](int, const Event& e) {
+      int slot = e.node + 1; // <- slot 0 is the block
+      total[slot] += e.duration;
+      count[slot]++;
+      if (e.duration > worst[slot]) { worst[slot] = e.duration; }
+    });
+    uint64_t blocks = count[0] > 0 ? count[0] : 1;
+    printf("%-24s %12s %12s %8s\n", "node", "mean us/blk", "max us", "share");
+    for (int slot = 0; slot <= maxNodes; slot++) {
+      if (count[slot] == 0) { continue; }
+      const char* name = slot == 0 ? (blockName() ? blockName() : "block") : nodeNames()[slot - 1];
+      printf("%-24s %12.3f %12.3f %7.1f%%\n", name,
+        total[slot] / ticksPerMicro / blocks, worst[slot] / ticksPerMicro,
+        100.0 * total[slot] / (total[0] > 0 ? total[0] : 1));
+    }
+  }
+
+private:
+  template<typename F>
+  static void forEachEvent (F f) {
+    int threads = numThreads().load();
+    if (threads > maxThreads) { threads = maxThreads; }
+    for (int t = 0; t < threads; t++) {
+      uint64_t n = counts()[t].load(std::memory_order_acquire);
+      uint64_t first = n > static_cast<uint64_t>(ringSize) ? n - ringSize : 0;
+      for (uint64_t i = first; i < n; i++) { f(t, rings()[t][i & (ringSize - 1)]); }
+    }
+  }
+
+  // ticks per microsecond, measured against the steady clock
+  static double calibrate () {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t tickStart = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t ticks = now() - tickStart;
+    double micros = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - wallStart).count();
+    return ticks / micros;
+#else
+    return 1000.0; // <- already nanoseconds
+#endif
+  }
+
+  static Event (*rings ())[ringSize] { static Event pool[maxThreads][ringSize]; return pool; }
+  static std::atomic<uint64_t>* counts () { static std::atomic<uint64_t> c[maxThreads]; return c; }
+  static int* threadIds () { static int ids[maxThreads]; return ids; }
+  static std::atomic<int>& numThreads () { static std::atomic<int> n{0}; return n; }
+  static const char** nodeNames () { static const char* names[maxNodes]; return names; }
+  static std::atomic<int>& numNodes () { static std::atomic<int> n{0}; return n; }
+  static const char*& blockName () { static const char* name = nullptr; return name; }
+};
+
+// RAII helpers behind the macros
+class TraceBlockScope {
+public:
+  TraceBlockScope (const char* name) {Trace::beginBlock(name);}
+  ~TraceBlockScope () {Trace::endBlock();}
+};
+
+class TraceNodeScope {
+public:
+  TraceNodeScope (int id) : node(id), start(Trace::now()) {}
+  ~TraceNodeScope () {
+    Trace::ThreadState& state = Trace::thread();
+    state.nodeTicks[node] += Trace::now() - start;
+    state.nodeUsed[node] = true;
+  }
+private:
+  int node;
+  uint64_t start;
+};
+
+#define DSP_TRACE_CONCAT2(a, b) a##b
+#define DSP_TRACE_CONCAT(a, b) DSP_TRACE_CONCAT2(a, b)
+#define DSP_TRACE_BLOCK(name) TraceBlockScope DSP_TRACE_CONCAT(traceBlock, __LINE__)(name)
+#define DSP_TRACE_NODE(name) \
+  static const int DSP_TRACE_CONCAT(traceId, __LINE__) = Trace::nodeId(name); \
+  TraceNodeScope DSP_TRACE_CONCAT(traceNode, __LINE__)(DSP_TRACE_CONCAT(traceId, __LINE__))
+
+#else
+
+#define DSP_TRACE_BLOCK(name) do {} while (0)
+#define DSP_TRACE_NODE(name) do {} while (0)
+
+#endif // DSP_TRACE
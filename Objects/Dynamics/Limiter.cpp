@@ -0,0 +1,104 @@
+/*
+Implementation of a lookahead brickwall limiter.
+
+Audio runs through a delay of lookahead samples, so the gain can start
+falling before a peak reaches the output. The peak over the lookahead
+window comes from a monotonic deque, which is O(1) amortized per sample
+instead of rescanning the window. The gain follows the required gain
+with a one-pole attack sized to settle within the lookahead and a slower
+one-pole release, so the gain is already down when the peak comes out of
+the delay. The smoothed gain is then clamped against the sample actually
+leaving the delay, so no output sample can exceed the threshold; the
+clamp only catches the last couple of percent the attack hasn't settled.
+
+One instance per channel. All memory is allocated in the constructor.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "../Utility/FastMath.cpp"
+
+class Limiter {
+public:
+  Limiter (int samprate, float lookaheadMs = 1.5f, float releaseMs = 50.f) :
+  sampleRate(samprate) {
+    lookahead = static_cast<int>(lookaheadMs * sampleRate / 1000.f);
+    if (lookahead < 1) { lookahead = 1; }
+    int size = 1;
+    while (size < lookahead + 2) { size *= 2; }
+    mask = size - 1;
+    delay.assign(size, 0.f);
+    dequeValue.assign(size, 0.f);
+    dequePos.assign(size, 0);
+    attackCoef = 1.f - expf(-4.f / lookahead); // <- ~98% settled after lookahead samples
+    setRelease(releaseMs);
+  }
+
+  void setThreshold (float dB) {threshold = dBtoA(dB);}
+  void setRelease (float ms) {
+    releaseCoef = 1.f - expf(-1000.f / (ms * sampleRate));
+    releaseTail = static_cast<int>(ceilf(logf(1e-6f) / log1pf(-releaseCoef))); // <- any reduction back within 1e-6 of unity
+  }
+
+  float processSample (float input) {
+    // sliding max of |x| over the last lookahead + 1 samples
+    float level = fabsf(input);
+    while (dequeSize > 0 && dequeValue[(dequeHead + dequeSize - 1) & mask] <= level) {
+      dequeSize--;
+    }
+    dequeValue[(dequeHead + dequeSize) & mask] = level;
+    dequePos[(dequeHead + dequeSize) & mask] = position;
+    dequeSize++;
+    while (position - dequePos[dequeHead] > lookahead) {
+      dequeHead = (dequeHead + 1) & mask;
+      dequeSize--;
+    }
+    float peak = dequeValue[dequeHead];
+
+    // smooth toward the gain that keeps the window peak under threshold
+    float target = peak > threshold ? threshold / peak : 1.f;
+    float coef = target < gain ? attackCoef : releaseCoef;
+    gain += coef * (target - gain);
+
+    delay[position & mask] = input;
+    float delayed = delay[(position - lookahead) & mask];
+    position++;
+    float outLevel = fabsf(delayed);
+    float limit = outLevel > threshold ? threshold / outLevel : 1.f;
+    float applied = gain < limit ? gain : limit; // <- brickwall guarantee, on the sample going out
+    appliedGain = applied;
+    return delayed * applied;
+  }
+
+  void processBlock (const float* input, float* output, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      output[i] = processSample(input[i]);
+    }
+  }
+
+  float getGainReductiondB () const {return ampTodB(appliedGain);}
+  int getLatency () const {return lookahead;}
+  // the delay flushed and the gain released, so a bypass never freezes a reduction
+  int getTailLength () const {return lookahead + 1 + releaseTail;}
+
+private:
+  int sampleRate;
+  int lookahead;
+  int mask;
+  float threshold = 0.966f; // <- -0.3 dBFS
+  float attackCoef;
+  float releaseCoef;
+  int releaseTail;
+  float gain = 1.f;
+  float appliedGain = 1.f;
+  long long position = 0;
+
+  std::vector<float> delay;
+  std::vector<float> dequeValue; // <- monotonic deque as a ring
+  std::vector<long long> dequePos;
+  int dequeHead = 0;
+  int dequeSize = 0;
+};
@@ -0,0 +1,248 @@
+/*
+Implementation of a bank of biquad filter cascades, one cascade per lane.
+
+Each lane is a chain of up to maxStages transposed direct form II
+biquads. Lanes are independent channels or bands and are processed side
+by side. State and coefficients are stored [stage][lane], so one
+processFrame() is a loop across lanes that the compiler turns into SIMD:
+4 lanes fill an SSE register, 8 an AVX register. Lanes = 1 works too,
+for a single mono cascade.
+
+Coefficient changes are smoothed. setStage() sets a target, and the live
+coefficients ramp to it linearly over smoothingMs, so a sweeping cutoff
+doesn't click. Once the ramp ends the per-sample smoothing work stops.
+
+Designs follow the RBJ audio EQ cookbook: low/high-pass, peak,
+low/high shelf, plus toneStack() for a bass/mid/treble cascade.
+
+getTailLength() estimates how long the cascade rings after its input
+goes silent: each stage's largest pole radius gives the samples for its
+impulse response to fall tailDecaydB, and the stages add up.
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include "../Utility/AudioBlock.cpp"
+
+struct BiquadCoefs {
+  float b0 = 1.f, b1 = 0.f, b2 = 0.f, a1 = 0.f, a2 = 0.f; // <- a0 normalized to 1
+
+  static BiquadCoefs lowPass (float samprate, float freq, float q = 0.7071f) {
+    Design d(samprate, freq, q);
+    return d.normalize((1.f - d.cosw) / 2.f, 1.f - d.cosw, (1.f - d.cosw) / 2.f,
+      1.f + d.alpha, -2.f * d.cosw, 1.f - d.alpha);
+  }
+
+  static BiquadCoefs highPass (float samprate, float freq, float q = 0.7071f) {
+    Design d(samprate, freq, q);
+    return d.normalize((1.f + d.cosw) / 2.f, -(1.f + d.cosw), (1.f + d.cosw) / 2.f,
+      1.f + d.alpha, -2.f * d.cosw, 1.f - d.alpha);
+  }
+
+  static BiquadCoefs peak (float samprate, float freq, float q, float gaindB) {
+    Design d(samprate, freq, q);
+    float A = powf(10.f, gaindB / 40.f);
+    return d.normalize(1.f + d.alpha * A, -2.f * d.cosw, 1.f - d.alpha * A,
+      1.f + d.alpha / A, -2.f * d.cosw, 1.f - d.alpha / A);
+  }
+
+  static BiquadCoefs lowShelf (float samprate, float freq, float gaindB) {
+    Design d(samprate, freq, 0.7071f);
+    float A = powf(10.f, gaindB / 40.f);
+    float k = 2.f * sqrtf(A) * d.alpha;
+    return d.normalize(A * ((A + 1.f) - (A - 1.f) * d.cosw + k),
+      2.f * A * ((A - 1.f) - (A + 1.f) * d.cosw), A * ((A + 1.f) - (A - 1.f) * d.cosw - k),
+      (A + 1.f) + (A - 1.f) * d.cosw + k, -2.f * ((A - 1.f) + (A + 1.f) * d.cosw),
+      (A + 1.f) + (A - 1.f) * d.cosw - k);
+  }
+
+  static BiquadCoefs highShelf (float samprate, float freq, float gaindB) {
+    Design d(samprate, freq, 0.7071f);
+    float A = powf(10.f, gaindB / 40.f);
+    float k = 2.f * sqrtf(A) * d.alpha;
+    return d.normalize(A * ((A + 1.f) + (A - 1.f) * d.cosw + k),
+      -2.f * A * ((A - 1.f) + (A + 1.f) * d.cosw), A * ((A + 1.f) + (A - 1.f) * d.cosw - k),
+      (A + 1.f) - (A - 1.f) * d.cosw + k, 2.f * ((A - 1.f) - (A + 1.f) * d.cosw),
+      (A + 1.f) - (A - 1.f) * d.cosw - k);
+  }
+
+private:
+  struct Design {
+    float cosw, alpha;
+    Design (float samprate, float freq, float q) {
+      float nyquistSafe = freq < 0.49f * samprate ? freq : 0.49f * samprate;
+      float w = 2.f * static_cast<float>(M_PI) * nyquistSafe / samprate;
+      cosw = cosf(w);
+      alpha = sinf(w) / (2.f * q);
+    }
+    BiquadCoefs normalize (float b0, float b1, float b2, float a0, float a1, float a2) const {
+      BiquadCoefs c;
+      c.b0 = b0 / a0; c.b1 = b1 / a0; c.b2 = b2 / a0; c.a1 = a1 / a0; c.a2 = a2 / a0;
+      return c;
+    }
+  };
+};
+
+template<int Lanes, int maxStages = 4>
+class BiquadBank {
+public:
+  BiquadBank (int samprate, float smoothingMs = 20.f) : sampleRate(samprate) {
+    rampLength = static_cast<int>(smoothingMs * sampleRate / 1000.f);
+    if (rampLength < 1) { rampLength = 1; }
+    for (int s = 0; s < maxStages; s++) { // <- every stage starts as a pass-through
+      for (int l = 0; l < Lanes; l++) { set(s, l, BiquadCoefs(), true); }
+    }
+    rampRemaining = 0;
+  }
+
+  // target coefficients for one stage of one lane; jump skips the ramp
+  void setStage (int stage, int lane, const BiquadCoefs& c, bool jump = false) {
+    if (stage < 0 || stage >= maxStages || lane < 0 || lane >= Lanes) { return; }
+    set(stage, lane, c, jump);
+    if (stage >= numStages) { numStages = stage + 1; }
+  }
+
+  // bass/mid/treble in dB as stages 0-2 of a lane
+  void toneStack (int lane, float bassdB, float middB, float trebledB) {
+    setStage(0, lane, BiquadCoefs::lowShelf(sampleRate, 120.f, bassdB));
+    setStage(1, lane, BiquadCoefs::peak(sampleRate, 700.f, 0.8f, middB));
+    setStage(2, lane, BiquadCoefs::highShelf(sampleRate, 3200.f, trebledB));
+  }
+
+  // one sample for every lane, in place
+  void processFrame (float* frame) {
+    if (rampRemaining > 0) { stepRamp(); }
+    alignas(32) float x[Lanes]; // <- local copy, so the compiler knows nothing aliases it
+    for (int l = 0; l < Lanes; l++) { x[l] = frame[l]; }
+    for (int s = 0; s < numStages; s++) {
+      Stage& st = stages[s];
+      // one statement per loop, each loop across lanes becomes SIMD ops
+      alignas(32) float y[Lanes];
+      for (int l = 0; l < Lanes; l++) { y[l] = st.b0[l] * x[l] + st.s1[l]; }
+      for (int l = 0; l < Lanes; l++) { st.s1[l] = st.b1[l] * x[l] - st.a1[l] * y[l] + st.s2[l]; }
+      for (int l = 0; l < Lanes; l++) { st.s2[l] = st.b2[l] * x[l] - st.a2[l] * y[l]; }
+      for (int l = 0; l < Lanes; l++) { x[l] = y[l]; }
+    }
+    for (int l = 0; l < Lanes; l++) { frame[l] = x[l]; }
+  }
+
+  // planar block: channels[lane][sample]
+  void processBlock (float* const* channels, int numSamples) {
+    alignas(32) float frame[Lanes];
+    for (int i = 0; i < numSamples; i++) {
+      for (int l = 0; l < Lanes; l++) { frame[l] = channels[l][i]; }
+      processFrame(frame);
+      for (int l = 0; l < Lanes; l++) { channels[l][i] = frame[l]; }
+    }
+  }
+
+  // in place, channel l through lane l; lanes past the last channel see silence
+  void processBlock (AudioBlock<float> block) {
+    int channels = block.getNumChannels() < Lanes ? block.getNumChannels() : Lanes;
+    alignas(32) float frame[Lanes];
+    for (int i = 0; i < block.getNumSamples(); i++) {
+      for (int l = 0; l < Lanes; l++) { frame[l] = l < channels ? block.getChannel(l)[i] : 0.f; }
+      processFrame(frame);
+      for (int l = 0; l < channels; l++) { block.getChannel(l)[i] = frame[l]; }
+    }
+  }
+
+  float processSample (float input) { // <- lane 0 only, for Lanes == 1
+    alignas(32) float frame[Lanes] = {};
+    frame[0] = input;
+    processFrame(frame);
+    return frame[0];
+  }
+
+  void reset () {
+    for (Stage& st : stages) {
+      for (int l = 0; l < Lanes; l++) { st.s1[l] = 0.f; st.s2[l] = 0.f; }
+    }
+  }
+
+  int getLatency () const {return 0;} // <- IIR, no lookahead
+
+  // silent input samples until every lane has decayed; -1 if a stage doesn't decay
+  int getTailLength () const {
+    int total = 0;
+    for (int s = 0; s < numStages; s++) {
+      const Stage& st = stages[s];
+      int longest = 0;
+      for (int l = 0; l < Lanes; l++) { // <- mid-ramp, the longer of the live and target designs
+        int live = decaySamples(st.a1[l], st.a2[l]);
+        int target = decaySamples(st.target[3][l], st.target[4][l]);
+        if (live < 0 || target < 0) { return -1; }
+        longest = live > longest ? live : longest;
+        longest = target > longest ? target : longest;
+      }
+      total += longest;
+    }
+    return total;
+  }
+
+  static constexpr float tailDecaydB = 120.f;
+
+private:
+  struct Stage {
+    alignas(32) float b0[Lanes] = {}, b1[Lanes] = {}, b2[Lanes] = {}, a1[Lanes] = {}, a2[Lanes] = {};
+    alignas(32) float s1[Lanes] = {}, s2[Lanes] = {};
+    // ramp targets and per-sample steps
+    float target[5][Lanes] = {}, step[5][Lanes] = {};
+  };
+
+  // poles are the roots of z^2 + a1 z + a2; two samples of state on top
+  static int decaySamples (float a1, float a2) {
+    float discriminant = a1 * a1 - 4.f * a2;
+    float radius;
+    if (discriminant < 0.f) { radius = sqrtf(a2); } // <- complex pair
+    else {
+      float root = sqrtf(discriminant);
+      radius = 0.5f * (fabsf(a1) + root); // <- the larger real root
+    }
+    if (radius >= 1.f) { return -1; }
+    if (radius < 1e-6f) { return 2; }
+    return 2 + static_cast<int>(ceilf(-tailDecaydB / (20.f * log10f(radius))));
+  }
+
+  void set (int s, int l, const BiquadCoefs& c, bool jump) {
+    Stage& st = stages[s];
+    const float values[5] = {c.b0, c.b1, c.b2, c.a1, c.a2};
+    float* live[5] = {st.b0, st.b1, st.b2, st.a1, st.a2};
+    for (int k = 0; k < 5; k++) {
+      st.target[k][l] = values[k];
+      if (jump) { live[k][l] = values[k]; }
+    }
+    // restart the ramp for every stage so all lanes land together
+    for (int t = 0; t < maxStages; t++) {
+      Stage& other = stages[t];
+      float* otherLive[5] = {other.b0, other.b1, other.b2, other.a1, other.a2};
+      for (int k = 0; k < 5; k++) {
+        for (int m = 0; m < Lanes; m++) {
+          other.step[k][m] = (other.target[k][m] - otherLive[k][m]) / rampLength;
+        }
+      }
+    }
+    rampRemaining = rampLength;
+  }
+
+  void stepRamp () {
+    bool last = --rampRemaining == 0;
+    for (int s = 0; s < numStages; s++) {
+      Stage& st = stages[s];
+      float* live[5] = {st.b0, st.b1, st.b2, st.a1, st.a2};
+      for (int k = 0; k < 5; k++) {
+        for (int l = 0; l < Lanes; l++) {
+          live[k][l] = last ? st.target[k][l] : live[k][l] + st.step[k][l]; // <- land exactly
+        }
+      }
+    }
+  }
+
+  int sampleRate;
+  int rampLength;
+  int rampRemaining = 0;
+  int numStages = 0;
+  Stage stages[maxStages];
+};
@@ -0,0 +1,280 @@
+/*
+Implementation of complex and real-input FFTs for any size, with shared
+plans.
+
+The transform is a Stockham autosort FFT on split real/imaginary arrays,
+so it needs no bit reversal and any factorization works. Sizes are
+factored into radix 4, 2, 3 and 5 passes, which run as DSPCore kernels
+(SSE2/AVX2/AVX-512 by CPUID). Any other prime factor runs as a generic
+O(n p) pass here, so prefer sizes made of 2, 3 and 5 (480, 960, 1000,
+1536 are all fast).
+
+An FFTPlan (factors and twiddles) is immutable and shared: FFTPlan::get()
+returns the cached plan for a size and builds it the first time. FFT and
+RealFFT each hold a plan plus one workspace allocated in the constructor,
+so transforms never allocate. Construct them off the audio thread; one
+object per thread.
+
+RealFFT packs an even-sized real input into a half-size complex
+transform and unpacks the N / 2 + 1 bins, about twice as fast as a
+complex transform of the same size. Forward transforms are unscaled;
+inverse transforms scale by 1 / N, so inverse(forward(x)) == x.
+
+Needs DSPCore to be linked.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../Kernels/DSPKernels.cpp"
+
+class FFTPlan {
+public:
+  struct Pass {
+    int radix;
+    int m; // <- butterflies per column: size / (radix x stride)
+    int stride;
+    int twiddleOffset; // <- (radix - 1) x m twiddles
+  };
+
+  // cached plan for this size, built on first use (not on the audio thread)
+  static std::shared_ptr<const FFTPlan> get (int size) {
+    static std::mutex mutex;
+    static std::map<int, std::shared_ptr<const FFTPlan>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const FFTPlan>& plan = cache[size];
+    if (!plan) { plan.reset(new FFTPlan(size)); }
+    return plan;
+  }
+
+  int getSize () const {return size;}
+  const std::vector<Pass>& getPasses () const {return passes;}
+  const float* getTwiddleRe () const {return twiddleRe.data();}
+  const float* getTwiddleIm () const {return twiddleIm.data();}
+  // e^(-i pi k / size), k = 0..size: unpacks a real transform of twice this size
+  const float* getHalfTurnRe () const {return halfTurnRe.data();}
+  const float* getHalfTurnIm () const {return halfTurnIm.data();}
+
+private:
+  FFTPlan (int fftSize) : size(fftSize < 1 ? 1 : fftSize) {
+    int remaining = size;
+    std::vector<int> radices;
+    while (remaining % 4 == 0) { radices.push_back(4); remaining /= 4; }
+    while (remaining % 2 == 0) { radices.push_back(2); remaining /= 2; }
+    for (int p = 3; remaining > 1; p += 2) {
+      while (remaining % p == 0) { radices.push_back(p); remaining /= p; }
+    }
+    int stride = 1;
+    int n = size;
+    for (int radix : radices) {
+      int m = n / radix;
+      passes.push_back({radix, m, stride, static_cast<int>(twiddleRe.size())});
+      for (int k = 1; k < radix; k++) {
+        for (int p = 0; p < m; p++) {
+          double angle = -2.0 * M_PI * p * k / n;
+          twiddleRe.push_back(static_cast<float>(cos(angle)));
+          twiddleIm.push_back(static_cast<float>(sin(angle)));
+        }
+      }
+      n = m;
+      stride *= radix;
+    }
+    for (int k = 0; k <= size; k++) {
+      double angle = -M_PI * k / size;
+      halfTurnRe.push_back(static_cast<float>(cos(angle)));
+      halfTurnIm.push_back(static_cast<float>(sin(angle)));
+    }
+  }
+
+  int size;
+  std::vector<Pass> passes;
+  std::vector<float> twiddleRe, twiddleIm;
+  std::vector<float> halfTurnRe, halfTurnIm;
+};
+
+class FFT {
+public:
+  FFT (int size) : plan(FFTPlan::get(size)), fftSize(plan->getSize()), workspace(4 * fftSize) {
+    for (const FFTPlan::Pass& pass : plan->getPasses()) {
+      if (pass.radix > 5 && pass.radix > maxRadix) { maxRadix = pass.radix; }
+    }
+    scratch.resize(4 * maxRadix); // <- generic passes only
+    kernels = &dspKernels(); // <- detect here, not on the first transform
+  }
+
+  // forward transform, in place
+  void transform (std::complex<float>* data) {
+    float* re = workspace.data() + 2 * fftSize;
+    float* im = re + fftSize;
+    deinterleave(data, re, im);
+    transform(re, im);
+    interleave(re, im, data);
+  }
+
+  // inverse transform scaled by 1 / size, in place
+  void inverse (std::complex<float>* data) {
+    float* re = workspace.data() + 2 * fftSize;
+    float* im = re + fftSize;
+    deinterleave(data, re, im);
+    inverse(re, im);
+    interleave(re, im, data);
+  }
+
+  // split real / imaginary arrays, in place
+  void transform (float* re, float* im) {run(re, im);}
+
+  void inverse (float* re, float* im) {
+    run(im, re); // <- swapping re and im turns the forward DFT into the inverse
+    float scale = 1.f / fftSize;
+    for (int i = 0; i < fftSize; i++) { re[i] *= scale; im[i] *= scale; }
+  }
+
+  int getSize () const {return fftSize;}
+  const FFTPlan& getPlan () const {return *plan;}
+
+private:
+  void deinterleave (const std::complex<float>* data, float* re, float* im) {
+    const float* raw = reinterpret_cast<const float*>(data);
+    for (int i = 0; i < fftSize; i++) { re[i] = raw[2 * i]; im[i] = raw[2 * i + 1]; }
+  }
+
+  void interleave (const float* re, const float* im, std::complex<float>* data) {
+    float* raw = reinterpret_cast<float*>(data);
+    for (int i = 0; i < fftSize; i++) { raw[2 * i] = re[i]; raw[2 * i + 1] = im[i]; }
+  }
+
+  // ping-pong between the caller's arrays and the first half of the workspace
+  void run (float* re, float* im) {
+    float* xr = re;
+    float* xi = im;
+    float* yr = workspace.data();
+    float* yi = yr + fftSize;
+    const float* twRe = plan->getTwiddleRe();
+    const float* twIm = plan->getTwiddleIm();
+    for (const FFTPlan::Pass& pass : plan->getPasses()) {
+      if (pass.radix <= 5) {
+        kernels->fftPass(pass.radix, pass.m, pass.stride, twRe + pass.twiddleOffset, twIm + pass.twiddleOffset,
+          xr, xi, yr, yi);
+      } else {
+        genericPass(pass, twRe + pass.twiddleOffset, twIm + pass.twiddleOffset, xr, xi, yr, yi);
+      }
+      std::swap(xr, yr);
+      std::swap(xi, yi);
+    }
+    if (xr != re) { // <- odd number of passes: result is in the workspace
+      for (int i = 0; i < fftSize; i++) { re[i] = xr[i]; im[i] = xi[i]; }
+    }
+  }
+
+  // any prime radix as a direct DFT, same layout as the kernel passes
+  void genericPass (const FFTPlan::Pass& pass, const float* twRe, const float* twIm,
+    const float* xr, const float* xi, float* yr, float* yi) {
+    int r = pass.radix, m = pass.m, s = pass.stride;
+    float* ar = scratch.data();
+    float* ai = ar + maxRadix;
+    float* rootRe = ai + maxRadix;
+    float* rootIm = rootRe + maxRadix;
+    for (int j = 0; j < r; j++) { // <- roots of unity for this radix, cheap next to the pass itself
+      rootRe[j] = static_cast<float>(cos(-2.0 * M_PI * j / r));
+      rootIm[j] = static_cast<float>(sin(-2.0 * M_PI * j / r));
+    }
+    for (int p = 0; p < m; p++) {
+      for (int q = 0; q < s; q++) {
+        for (int j = 0; j < r; j++) { ar[j] = xr[q + s * (p + j * m)]; ai[j] = xi[q + s * (p + j * m)]; }
+        for (int k = 0; k < r; k++) {
+          float sumRe = 0.f, sumIm = 0.f;
+          for (int j = 0, index = 0; j < r; j++, index = (index + k) % r) {
+            sumRe += ar[j] * rootRe[index] - ai[j] * rootIm[index];
+            sumIm += ar[j] * rootIm[index] + ai[j] * rootRe[index];
+          }
+          float wr = k == 0 ? 1.f : twRe[(k - 1) * m + p];
+          float wi = k == 0 ? 0.f : twIm[(k - 1) * m + p];
+          yr[q + s * (r * p + k)] = sumRe * wr - sumIm * wi;
+          yi[q + s * (r * p + k)] = sumRe * wi + sumIm * wr;
+        }
+      }
+    }
+  }
+
+  std::shared_ptr<const FFTPlan> plan;
+  int fftSize;
+  std::vector<float> workspace; // <- ping-pong buffer, then split copy for the complex API
+  std::vector<float> scratch;
+  int maxRadix = 0;
+  const DSPKernels* kernels;
+};
+
+// size real samples <-> size / 2 + 1 complex bins
+class RealFFT {
+public:
+  RealFFT (int size) : realSize(size < 2 ? 2 : size), half(realSize / 2),
+  fft(realSize % 2 == 0 ? half : realSize), workspace(realSize % 2 == 0 ? 2 * half + 2 : 2 * realSize) {}
+
+  void forward (const float* input, std::complex<float>* output) {
+    float* out = reinterpret_cast<float*>(output);
+    float* zr = workspace.data();
+    float* zi = zr + (realSize % 2 == 0 ? half + 1 : realSize);
+    if (realSize % 2 != 0) { // <- odd: plain complex transform
+      for (int i = 0; i < realSize; i++) { zr[i] = input[i]; zi[i] = 0.f; }
+      fft.transform(zr, zi);
+      for (int k = 0; k <= half; k++) { out[2 * k] = zr[k]; out[2 * k + 1] = zi[k]; }
+      return;
+    }
+    for (int n = 0; n < half; n++) { zr[n] = input[2 * n]; zi[n] = input[2 * n + 1]; }
+    fft.transform(zr, zi);
+    zr[half] = zr[0]; // <- Z[half] wraps to Z[0]
+    zi[half] = zi[0];
+    const float* wr = fft.getPlan().getHalfTurnRe();
+    const float* wi = fft.getPlan().getHalfTurnIm();
+    for (int k = 0; k <= half; k++) {
+      float ar = zr[k], ai = zi[k];
+      float br = zr[half - k], bi = -zi[half - k]; // <- conj(Z[half - k])
+      float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi); // <- even samples' spectrum
+      float orr = 0.5f * (ai - bi), oi = 0.5f * (br - ar); // <- odd samples': (a - b) / 2i
+      out[2 * k] = er + orr * wr[k] - oi * wi[k];
+      out[2 * k + 1] = ei + orr * wi[k] + oi * wr[k];
+    }
+  }
+
+  // scaled by 1 / size
+  void inverse (const std::complex<float>* input, float* output) {
+    const float* in = reinterpret_cast<const float*>(input);
+    float* zr = workspace.data();
+    float* zi = zr + (realSize % 2 == 0 ? half + 1 : realSize);
+    if (realSize % 2 != 0) { // <- rebuild the full hermitian spectrum
+      for (int k = 0; k <= half; k++) { zr[k] = in[2 * k]; zi[k] = in[2 * k + 1]; }
+      for (int k = half + 1; k < realSize; k++) { zr[k] = in[2 * (realSize - k)]; zi[k] = -in[2 * (realSize - k) + 1]; }
+      fft.inverse(zr, zi);
+      for (int i = 0; i < realSize; i++) { output[i] = zr[i]; }
+      return;
+    }
+    const float* wr = fft.getPlan().getHalfTurnRe();
+    const float* wi = fft.getPlan().getHalfTurnIm();
+    for (int k = 0; k < half; k++) {
+      float ar = in[2 * k], ai = in[2 * k + 1];
+      float br = in[2 * (half - k)], bi = -in[2 * (half - k) + 1]; // <- conj(X[half - k])
+      float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+      float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+      float orr = dr * wr[k] + di * wi[k], oi = di * wr[k] - dr * wi[k]; // <- times conj(w)
+      zr[k] = er - oi; // <- Z = even + i odd
+      zi[k] = ei + orr;
+    }
+    fft.inverse(zr, zi);
+    for (int n = 0; n < half; n++) { output[2 * n] = zr[n]; output[2 * n + 1] = zi[n]; }
+  }
+
+  int getSize () const {return realSize;}
+  int getNumBins () const {return half + 1;}
+
+private:
+  int realSize;
+  int half;
+  FFT fft;
+  std::vector<float> workspace;
+};
@@ -0,0 +1,232 @@
+/*
+Implementation of a low-latency ALSA backend using direct mmap transfers
+(Linux only).
+
+Playback, and capture when channelsIn > 0, are opened on the same device
+with MMAP_INTERLEAVED access. Samples are converted straight into and out
+of the driver's ring buffer, with no intermediate read/write copy. The
+audio thread asks for SCHED_FIFO and sleeps in snd_pcm_wait(). Capture
+and playback are linked so they start together. Latency is blockSize x
+periods frames, 2 x 128 at 48 kHz by default. xruns are recovered,
+counted as late blocks, and the playback ring is primed again.
+
+Sample format is negotiated: float, then S32, then S16. Use a "hw:" device
+for the lowest latency, or "default" to go through plug.
+
+Compile with -DAUDIO_USE_ALSA and link -lasound. Otherwise open() just
+returns false.
+*/
+
+#pragma once
+
+#include "AudioBackend.cpp"
+
+#ifdef AUDIO_USE_ALSA
+#include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#endif
+
+class AlsaBackend : public AudioBackend {
+public:
+  ~AlsaBackend () {stop(); close();}
+  const char* name () const override {return "alsa";}
+
+  bool open (AudioConfig& cfg) override {
+#ifdef AUDIO_USE_ALSA
+    close();
+    if (snd_pcm_open(&playback, cfg.device.c_str(), SND_PCM_STREAM_PLAYBACK, 0) < 0) { return false; }
+    if (!configure(playback, cfg.channelsOut, cfg, playbackFormat)) { close(); return false; }
+    if (cfg.channelsIn > 0) {
+      if (snd_pcm_open(&capture, cfg.device.c_str(), SND_PCM_STREAM_CAPTURE, 0) < 0 ||
+          !configure(capture, cfg.channelsIn, cfg, captureFormat)) {
+        if (capture != nullptr) { snd_pcm_close(capture); capture = nullptr; }
+        cfg.channelsIn = 0; // <- playback only
+      } else {
+        linked = snd_pcm_link(capture, playback) == 0;
+      }
+    }
+    config = cfg;
+    allocate(config);
+    return true;
+#else
+    (void)cfg;
+    return false;
+#endif
+  }
+
+  bool start (AudioProcessor& processor) override {
+#ifdef AUDIO_USE_ALSA
+    if (playback == nullptr) { return false; }
+    stop();
+    processor.prepare(config.sampleRate, config.blockSize, config.channelsIn, config.channelsOut);
+    running = true;
+    worker = std::thread([this, &processor] {run(processor);});
+    return true;
+#else
+    (void)processor;
+    return false;
+#endif
+  }
+
+  void stop () override {
+    running = false;
+    if (worker.joinable()) { worker.join(); }
+  }
+
+  void close () {
+#ifdef AUDIO_USE_ALSA
+    if (capture != nullptr) { snd_pcm_close(capture); capture = nullptr; }
+    if (playback != nullptr) { snd_pcm_close(playback); playback = nullptr; }
+#endif
+  }
+
+private:
+  AudioConfig config;
+
+#ifdef AUDIO_USE_ALSA
+  snd_pcm_t* playback = nullptr;
+  snd_pcm_t* capture = nullptr;
+  snd_pcm_format_t playbackFormat = SND_PCM_FORMAT_FLOAT_LE;
+  snd_pcm_format_t captureFormat = SND_PCM_FORMAT_FLOAT_LE;
+  bool linked = false;
+  unsigned int periods = 2;
+
+  bool configure (snd_pcm_t* pcm, int channels, AudioConfig& cfg, snd_pcm_format_t& format) {
+    snd_pcm_hw_params_t* hw;
+    snd_pcm_hw_params_alloca(&hw);
+    if (snd_pcm_hw_params_any(pcm, hw) < 0) { return false; }
+    if (snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0) { return false; }
+    const snd_pcm_format_t preferred[] = {SND_PCM_FORMAT_FLOAT_LE, SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_S16_LE};
+    bool found = false;
+    for (snd_pcm_format_t f : preferred) {
+      if (snd_pcm_hw_params_test_format(pcm, hw, f) == 0) { format = f; found = true; break; }
+    }
+    if (!found || snd_pcm_hw_params_set_format(pcm, hw, format) < 0) { return false; }
+    if (snd_pcm_hw_params_set_channels(pcm, hw, channels) < 0) { return false; }
+    unsigned int rate = cfg.sampleRate;
+    if (snd_pcm_hw_params_set_rate_near(pcm, hw, &rate, nullptr) < 0) { return false; }
+    snd_pcm_uframes_t period = cfg.blockSize;
+    if (snd_pcm_hw_params_set_period_size_near(pcm, hw, &period, nullptr) < 0) { return false; }
+    unsigned int count = periods;
+    if (snd_pcm_hw_params_set_periods_near(pcm, hw, &count, nullptr) < 0) { return false; }
+    if (snd_pcm_hw_params(pcm, hw) < 0) { return false; }
+    periods = count;
+    cfg.sampleRate = static_cast<int>(rate);
+    cfg.blockSize = static_cast<int>(period);
+
+    snd_pcm_sw_params_t* sw;
+    snd_pcm_sw_params_alloca(&sw);
+    snd_pcm_sw_params_current(pcm, sw);
+    snd_pcm_sw_params_set_avail_min(pcm, sw, period);
+    return snd_pcm_sw_params(pcm, sw) >= 0;
+  }
+
+  void run (AudioProcessor& processor) {
+    sched_param param;
+    param.sched_priority = 80;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); // <- best effort, needs rtprio
+
+    double period = static_cast<double>(config.blockSize) / config.sampleRate;
+    prime();
+    while (running.load()) {
+      if (capture != nullptr && transfer(capture, captureFormat, config.channelsIn, true) < 0) {
+        recover();
+        continue;
+      }
+      runBlock(processor, config.blockSize, period);
+      if (transfer(playback, playbackFormat, config.channelsOut, false) < 0) { recover(); }
+    }
+    snd_pcm_drop(playback);
+    if (capture != nullptr && !linked) { snd_pcm_drop(capture); }
+  }
+
+  // silence in every playback period, then start both streams; mmap commits never start a stream by themselves
+  void prime () {
+    outputs.getBlock().clear();
+    snd_pcm_prepare(playback);
+    for (unsigned int p = 0; p < periods; p++) { transfer(playback, playbackFormat, config.channelsOut, false); }
+    if (capture != nullptr && !linked) { snd_pcm_prepare(capture); }
+    if (capture != nullptr) { snd_pcm_start(capture); } // <- starts playback too when linked
+    if (capture == nullptr || !linked) { snd_pcm_start(playback); }
+  }
+
+  void recover () {
+    lateBlocks.fetch_add(1, std::memory_order_relaxed);
+    snd_pcm_drop(playback);
+    if (capture != nullptr && !linked) { snd_pcm_drop(capture); }
+    prime();
+  }
+
+  // one block between the planar buffers and the mmap ring; < 0 on xrun
+  int transfer (snd_pcm_t* pcm, snd_pcm_format_t format, int channels, bool isCapture) {
+    snd_pcm_uframes_t done = 0;
+    snd_pcm_uframes_t wanted = config.blockSize;
+    while (done < wanted) {
+      snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+      if (avail < 0) { return static_cast<int>(avail); }
+      if (static_cast<snd_pcm_uframes_t>(avail) < wanted - done) { // <- sleep until the rest fits
+        int err = snd_pcm_wait(pcm, 1000);
+        if (err < 0) { return err; }
+        if (err == 0) { return -EPIPE; } // <- device stalled
+        continue;
+      }
+      const snd_pcm_channel_area_t* areas;
+      snd_pcm_uframes_t offset;
+      snd_pcm_uframes_t frames = wanted - done;
+      int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+      if (err < 0) { return err; }
+      for (int ch = 0; ch < channels; ch++) {
+        unsigned char* base = static_cast<unsigned char*>(areas[ch].addr) +
+          (areas[ch].first + offset * areas[ch].step) / 8;
+        int stride = areas[ch].step / 8;
+        if (isCapture) {
+          fromDevice(base, stride, format, inputs.getChannel(ch) + done, static_cast<int>(frames));
+        } else {
+          toDevice(outputs.getChannel(ch) + done, base, stride, format, static_cast<int>(frames));
+        }
+      }
+      snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, frames);
+      if (committed < 0 || static_cast<snd_pcm_uframes_t>(committed) != frames) {
+        return committed < 0 ? static_cast<int>(committed) : -EPIPE;
+      }
+      done += frames;
+    }
+    return 0;
+  }
+
+  static void toDevice (const float* input, unsigned char* device, int stride, snd_pcm_format_t format, int frames) {
+    for (int i = 0; i < frames; i++, device += stride) {
+      float x = input[i] < -1.f ? -1.f : (input[i] > 1.f ? 1.f : input[i]);
+      if (format == SND_PCM_FORMAT_FLOAT_LE) {
+        memcpy(device, &x, 4);
+      } else if (format == SND_PCM_FORMAT_S32_LE) {
+        int32_t v = static_cast<int32_t>(x * 2147483392.f); // <- largest float below 2^31
+        memcpy(device, &v, 4);
+      } else {
+        int16_t v = static_cast<int16_t>(x * 32767.f);
+        memcpy(device, &v, 2);
+      }
+    }
+  }
+
+  static void fromDevice (const unsigned char* device, int stride, snd_pcm_format_t format, float* output, int frames) {
+    for (int i = 0; i < frames; i++, device += stride) {
+      if (format == SND_PCM_FORMAT_FLOAT_LE) {
+        memcpy(&output[i], device, 4);
+      } else if (format == SND_PCM_FORMAT_S32_LE) {
+        int32_t v;
+        memcpy(&v, device, 4);
+        output[i] = v / 2147483648.f;
+      } else {
+        int16_t v;
+        memcpy(&v, device, 2);
+        output[i] = v / 32768.f;
+      }
+    }
+  }
+#endif
+};
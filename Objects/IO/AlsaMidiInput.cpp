@@ -0,0 +1,106 @@
+/*
+Implementation of live MIDI input from the ALSA sequencer (Linux only).
+Opens a writable sequencer port named after the app; connect a keyboard
+to it with aconnect or a patchbay. A reader thread timestamps each event
+on the steady clock and pushes it to a MidiScheduler.
+
+Compile with -DMIDI_USE_ALSA and link -lasound. Otherwise open() just
+returns false.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "../Control/MidiScheduler.cpp"
+
+#ifdef MIDI_USE_ALSA
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#endif
+
+class AlsaMidiInput {
+public:
+  AlsaMidiInput (MidiScheduler& target) : scheduler(target) {}
+  ~AlsaMidiInput () {close();}
+
+  bool open (const char* clientName) {
+#ifdef MIDI_USE_ALSA
+    // non-blocking: the reader only sleeps in poll(), where it rechecks running
+    if (snd_seq_open(&seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0) { return false; }
+    snd_seq_set_client_name(seq, clientName);
+    port = snd_seq_create_simple_port(seq, "in",
+      SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+      SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    if (port < 0) { close(); return false; }
+    running = true;
+    reader = std::thread([this] { this->run(); });
+    return true;
+#else
+    (void)clientName;
+    return false;
+#endif
+  }
+
+  void close () {
+    running = false;
+    if (reader.joinable()) { reader.join(); }
+#ifdef MIDI_USE_ALSA
+    if (seq != nullptr) { snd_seq_close(seq); seq = nullptr; }
+#endif
+  }
+
+private:
+#ifdef MIDI_USE_ALSA
+  void run () {
+    int numFds = snd_seq_poll_descriptors_count(seq, POLLIN);
+    struct pollfd fds[4];
+    if (numFds > 4) { numFds = 4; }
+    snd_seq_poll_descriptors(seq, fds, numFds, POLLIN);
+    while (running) {
+      if (poll(fds, numFds, 100) <= 0) { continue; } // <- wake to check running
+      snd_seq_event_t* ev = nullptr;
+      while (snd_seq_event_input(seq, &ev) >= 0 && ev != nullptr) { // <- -EAGAIN once drained
+        MidiEvent event;
+        event.time = MidiEvent::now();
+        switch (ev->type) {
+          case SND_SEQ_EVENT_NOTEON:
+            event.status = 0x90 | ev->data.note.channel;
+            event.data1 = ev->data.note.note;
+            event.data2 = ev->data.note.velocity;
+            break;
+          case SND_SEQ_EVENT_NOTEOFF:
+            event.status = 0x80 | ev->data.note.channel;
+            event.data1 = ev->data.note.note;
+            event.data2 = ev->data.note.velocity;
+            break;
+          case SND_SEQ_EVENT_CONTROLLER:
+            event.status = 0xB0 | ev->data.control.channel;
+            event.data1 = ev->data.control.param;
+            event.data2 = ev->data.control.value;
+            break;
+          case SND_SEQ_EVENT_PITCHBEND: {
+            int bend = ev->data.control.value + 8192;
+            event.status = 0xE0 | ev->data.control.channel;
+            event.data1 = bend & 0x7F;
+            event.data2 = (bend >> 7) & 0x7F;
+            break;
+          }
+          default: // <- clock, active sensing, subscriptions...
+            event.status = 0;
+            break;
+        }
+        if (event.status != 0) { scheduler.push(event); }
+      }
+    }
+  }
+
+  snd_seq_t* seq = nullptr;
+  int port = -1;
+#endif
+
+  MidiScheduler& scheduler;
+  std::atomic<bool> running{false};
+  std::thread reader;
+};
@@ -0,0 +1,207 @@
+/*
+Thin audio backend layer between the DSP and whatever drives it.
+
+An AudioProcessor gets prepare() once and then process() for every
+block, as planar AudioBlocks over buffers the backend owns (64-byte
+aligned and padded, see AudioBlock.cpp). It doesn't know whether the blocks come
+from a sound card, a file or a timer. An AudioBackend owns the buffers
+and the thread that calls process():
+
+- NullBackend: no device, blocks paced by the steady clock. Good for
+  headless soak tests and CPU measurements at a given block size.
+- FileBackend: reads a WAV and writes a WAV, as fast as possible or
+  paced in real time.
+- AlsaBackend (AlsaBackend.cpp): direct ALSA mmap, Linux only.
+
+Backends count late blocks (callback overran its deadline), so a headless
+run reports the same xruns a device would. A backend that can't deliver
+its output (a full disk under FileBackend) stops and reports hasFailed().
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WavFile.cpp"
+#include "../Utility/AudioBlock.cpp"
+
+struct AudioConfig {
+  int sampleRate = 48000;
+  int blockSize = 128;
+  int channelsIn = 2;
+  int channelsOut = 2;
+  std::string device = "default"; // <- ALSA pcm name
+  std::string inputPath; // <- FileBackend
+  std::string outputPath;
+  bool realtime = false; // <- FileBackend: pace blocks like a device would
+  double seconds = 0.0; // <- NullBackend: stop after this long, 0 runs until stop()
+};
+
+class AudioProcessor {
+public:
+  virtual ~AudioProcessor () = default;
+  virtual void prepare (int samprate, int blockSize, int channelsIn, int channelsOut) = 0;
+  virtual void process (AudioBlock<const float> inputs, AudioBlock<float> outputs) = 0;
+  virtual int getLatency () const {return 0;} // <- samples, input to output
+};
+
+class AudioBackend {
+public:
+  virtual ~AudioBackend () = default;
+  virtual const char* name () const = 0;
+
+  // opens the device or files; may adjust config to what was granted
+  virtual bool open (AudioConfig& config) = 0;
+  virtual bool start (AudioProcessor& processor) = 0;
+  virtual void stop () = 0;
+
+  bool isRunning () const {return running.load();}
+  long long getBlocks () const {return blocks.load();}
+  long long getLateBlocks () const {return lateBlocks.load();}
+  double getWorstLoad () const {return worstLoad.load();} // <- callback time / block period
+  bool hasFailed () const {return failed.load();}
+
+protected:
+  void allocate (const AudioConfig& config) {
+    inputs.setSize(config.channelsIn, config.blockSize);
+    outputs.setSize(config.channelsOut, config.blockSize);
+    blocks = 0;
+    lateBlocks = 0;
+    worstLoad = 0.0;
+    failed = false;
+  }
+
+  // one timed callback; late if it took longer than the block period
+  void runBlock (AudioProcessor& processor, int numFrames, double periodSeconds) {
+    auto begin = std::chrono::steady_clock::now();
+    processor.process(inputs.getBlock(numFrames), outputs.getBlock(numFrames));
+    double load = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / periodSeconds;
+    if (load > worstLoad.load(std::memory_order_relaxed)) { worstLoad.store(load, std::memory_order_relaxed); }
+    if (load > 1.0) { lateBlocks.fetch_add(1, std::memory_order_relaxed); }
+    blocks.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  AudioBuffer<float> inputs;
+  AudioBuffer<float> outputs;
+  std::atomic<bool> running{false};
+  std::atomic<long long> blocks{0};
+  std::atomic<long long> lateBlocks{0};
+  std::atomic<double> worstLoad{0.0};
+  std::atomic<bool> failed{false};
+  std::thread worker;
+};
+
+// silent input, discarded output, one block every blockSize / sampleRate seconds
+class NullBackend : public AudioBackend {
+public:
+  ~NullBackend () {stop();}
+  const char* name () const override {return "null";}
+
+  bool open (AudioConfig& cfg) override {
+    config = cfg;
+    allocate(config);
+    return true;
+  }
+
+  bool start (AudioProcessor& processor) override {
+    stop();
+    processor.prepare(config.sampleRate, config.blockSize, config.channelsIn, config.channelsOut);
+    running = true;
+    worker = std::thread([this, &processor] {
+      double period = static_cast<double>(config.blockSize) / config.sampleRate;
+      long long maxBlocks = config.seconds > 0.0 ? static_cast<long long>(config.seconds / period) : -1;
+      auto next = std::chrono::steady_clock::now();
+      auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(period));
+      while (running.load() && blocks.load() != maxBlocks) {
+        runBlock(processor, config.blockSize, period);
+        next += step;
+        std::this_thread::sleep_until(next); // <- absolute deadlines, no drift
+      }
+      running = false;
+    });
+    return true;
+  }
+
+  void stop () override {
+    running = false;
+    if (worker.joinable()) { worker.join(); }
+  }
+
+private:
+  AudioConfig config;
+};
+
+// WAV in, WAV out; channelsIn follows the input file
+class FileBackend : public AudioBackend {
+public:
+  ~FileBackend () {stop();}
+  const char* name () const override {return "file";}
+
+  bool open (AudioConfig& cfg) override {
+    if (!reader.open(cfg.inputPath.c_str())) { return false; }
+    cfg.channelsIn = reader.getChannels();
+    cfg.sampleRate = reader.getSampleRate();
+    if (!writer.open(cfg.outputPath.c_str(), cfg.channelsOut, cfg.sampleRate)) { return false; }
+    config = cfg;
+    allocate(config);
+    interleavedIn.assign(config.blockSize * config.channelsIn, 0.f);
+    interleavedOut.assign(config.blockSize * config.channelsOut, 0.f);
+    return true;
+  }
+
+  // runs once per open(): the writer is closed when the input runs out
+  bool start (AudioProcessor& processor) override {
+    if (worker.joinable()) { return false; }
+    processor.prepare(config.sampleRate, config.blockSize, config.channelsIn, config.channelsOut);
+    running = true;
+    worker = std::thread([this, &processor] {
+      double period = static_cast<double>(config.blockSize) / config.sampleRate;
+      auto next = std::chrono::steady_clock::now();
+      auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(period));
+      int frames;
+      while (running.load() && (frames = reader.read(interleavedIn.data(), config.blockSize)) > 0) {
+        for (int ch = 0; ch < config.channelsIn; ch++) { // <- deinterleave, zero-pad the last block
+          for (int i = 0; i < config.blockSize; i++) {
+            inputs.getChannel(ch)[i] = i < frames ? interleavedIn[i * config.channelsIn + ch] : 0.f;
+          }
+        }
+        runBlock(processor, config.blockSize, period);
+        for (int ch = 0; ch < config.channelsOut; ch++) {
+          for (int i = 0; i < frames; i++) { interleavedOut[i * config.channelsOut + ch] = outputs.getChannel(ch)[i]; }
+        }
+        if (!writer.write(interleavedOut.data(), frames)) { // <- disk full: stop, don't fake a finished run
+          failed = true;
+          break;
+        }
+        if (config.realtime) {
+          next += step;
+          std::this_thread::sleep_until(next);
+        }
+      }
+      if (!writer.close()) { failed = true; }
+      running = false;
+    });
+    return true;
+  }
+
+  void stop () override {
+    running = false;
+    if (worker.joinable()) { worker.join(); }
+    if (!writer.close()) { failed = true; } // <- opened but never started
+  }
+
+  uint64_t getFrames () const {return reader.getFrames();}
+
+private:
+  AudioConfig config;
+  WavReader reader;
+  WavWriter writer;
+  std::vector<float> interleavedIn;
+  std::vector<float> interleavedOut;
+};
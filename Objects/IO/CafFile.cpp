@@ -0,0 +1,87 @@
+/*
+Implementation of a streaming Core Audio Format (CAF) writer.
+
+CAF has 64-bit chunk sizes, so there is no 4 GB limit to work around.
+The data chunk is written with size -1 ("still being written"), which
+readers accept, and close() fills in the real size. A recording cut off
+by a crash still opens. Samples are 32-bit little-endian float, the same
+interface as WavWriter.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class CafWriter {
+public:
+  ~CafWriter () {close();}
+
+  bool open (const char* path, int numChannels, int samprate) {
+    close();
+    file = fopen(path, "wb");
+    if (file == nullptr) { return false; }
+    channels = numChannels;
+    sampleRate = samprate;
+    dataBytes = 0;
+    writeHeader(false);
+    return true;
+  }
+
+  // writes numFrames interleaved frames
+  bool write (const float* input, int numFrames) {
+    if (file == nullptr) { return false; }
+    size_t samples = static_cast<size_t>(numFrames) * channels;
+    size_t written = fwrite(input, 4, samples, file); // <- little-endian hosts only
+    dataBytes += written * 4;
+    return written == samples;
+  }
+
+  // fills in the data chunk size; false if any of it didn't reach the disk
+  bool close () {
+    if (file == nullptr) { return true; } // <- nothing open, nothing lost
+    bool ok = fseek(file, 0, SEEK_SET) == 0;
+    writeHeader(true);
+    ok = ferror(file) == 0 && ok;
+    ok = fclose(file) == 0 && ok; // <- flushes the buffer, so a full disk can show up only here
+    file = nullptr;
+    return ok;
+  }
+
+  uint64_t getFramesWritten () const {return dataBytes / (4 * channels);}
+
+private:
+  // 'caff' file header, 'desc' chunk, 'data' chunk header: 68 bytes
+  void writeHeader (bool final) {
+    unsigned char h[68] = {};
+    memcpy(h, "caff", 4);
+    put16(h + 4, 1); // <- version, flags 0
+    memcpy(h + 8, "desc", 4);
+    put64(h + 12, 32);
+    double rate = sampleRate;
+    uint64_t rateBits;
+    memcpy(&rateBits, &rate, 8);
+    put64(h + 20, rateBits);
+    memcpy(h + 28, "lpcm", 4);
+    put32(h + 32, 3); // <- float | little-endian
+    put32(h + 36, 4 * channels); // <- bytes per packet
+    put32(h + 40, 1); // <- frames per packet
+    put32(h + 44, channels);
+    put32(h + 48, 32);
+    memcpy(h + 52, "data", 4);
+    put64(h + 56, final ? dataBytes + 4 : ~0ull); // <- + edit count
+    // h + 64: edit count, 0
+    fwrite(h, 1, sizeof(h), file);
+  }
+
+  // CAF headers are big-endian
+  static void put16 (unsigned char* p, uint32_t v) {p[0] = v >> 8; p[1] = v;}
+  static void put32 (unsigned char* p, uint32_t v) {put16(p, v >> 16); put16(p + 2, v);}
+  static void put64 (unsigned char* p, uint64_t v) {put32(p, v >> 32); put32(p + 4, static_cast<uint32_t>(v));}
+
+  FILE* file = nullptr;
+  int channels = 0;
+  int sampleRate = 0;
+  uint64_t dataBytes = 0;
+};
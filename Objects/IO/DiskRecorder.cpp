@@ -0,0 +1,118 @@
+/*
+Implementation of a background disk recorder for the audio thread.
+
+writeBlock() copies an interleaved block into a large lock-free ring that
+is allocated in the constructor. The audio thread never opens, writes or
+waits on a file. A writer thread drains the ring in large chunks, so the
+disk sees big sequential writes whatever the audio buffer size. If the
+ring is full, the whole block is dropped and counted. The audio thread
+never blocks, and getDroppedBlocks() shows whether the disk kept up.
+
+start() and stop() run on a non-audio thread (GUI, key handler). stop()
+drains what is left and finalizes the header. WAV switches to RF64 past
+4 GB; CAF has no size limit and still opens if the app dies mid-take.
+The writer polls instead of being signalled, because waking a thread
+from the audio callback isn't real-time safe.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../Utility/SPSCRing.cpp"
+#include "WavFile.cpp"
+#include "CafFile.cpp"
+
+class DiskRecorder {
+public:
+  enum Format {WAV, CAF};
+
+  DiskRecorder (int numChannels, int samprate, float bufferSeconds = 20.f) :
+  channels(numChannels), sampleRate(samprate),
+  ring(static_cast<int>(bufferSeconds * samprate) * numChannels),
+  chunk(static_cast<size_t>(chunkFrames) * numChannels) {}
+
+  ~DiskRecorder () {stop();}
+
+  // non-audio thread
+  bool start (const char* path, Format fmt = WAV) {
+    stop();
+    while (ring.read(chunk.data(), static_cast<int>(chunk.size())) > 0) {} // <- discard a block pushed after the last stop
+    format = fmt;
+    bool opened = format == WAV ? wav.open(path, channels, sampleRate) :
+      caf.open(path, channels, sampleRate);
+    if (!opened) { return false; }
+    droppedBlocks.store(0);
+    framesWritten.store(0);
+    running.store(true);
+    writer = std::thread([this] {writerLoop();});
+    recording.store(true, std::memory_order_release);
+    return true;
+  }
+
+  // non-audio thread: flushes everything queued and closes the file
+  void stop () {
+    recording.store(false, std::memory_order_release);
+    if (!writer.joinable()) { return; }
+    running.store(false);
+    writer.join();
+    if (format == WAV) { wav.close(); } else { caf.close(); }
+  }
+
+  // audio thread: all of the block or none of it
+  bool writeBlock (const float* interleaved, int numFrames) {
+    if (!recording.load(std::memory_order_acquire)) { return false; }
+    int samples = numFrames * channels;
+    if (ring.availableToWrite() < samples) {
+      droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    ring.write(interleaved, samples);
+    return true;
+  }
+
+  bool isRecording () const {return recording.load(std::memory_order_relaxed);}
+  long long getDroppedBlocks () const {return droppedBlocks.load(std::memory_order_relaxed);}
+  int getChannels () const {return channels;}
+  uint64_t getFramesWritten () const {return framesWritten.load(std::memory_order_relaxed);}
+
+private:
+  static const int chunkFrames = 1 << 15; // <- frames per disk write
+
+  void writerLoop () {
+    int chunkSamples = static_cast<int>(chunk.size());
+    while (running.load()) {
+      bool halfFull = ring.availableToWrite() < ring.getCapacity() / 2;
+      if (ring.availableToRead() >= chunkSamples || halfFull) {
+        flush(ring.read(chunk.data(), chunkSamples));
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+    int got;
+    while ((got = ring.read(chunk.data(), chunkSamples)) > 0) { flush(got); } // <- drain on stop
+  }
+
+  void flush (int samples) {
+    int frames = samples / channels;
+    if (format == WAV) { wav.write(chunk.data(), frames); } else { caf.write(chunk.data(), frames); }
+    framesWritten.fetch_add(frames, std::memory_order_relaxed);
+  }
+
+  int channels;
+  int sampleRate;
+  Format format = WAV;
+  SPSCRing<float> ring;
+  std::vector<float> chunk;
+  WavWriter wav;
+  CafWriter caf;
+  std::thread writer;
+  std::atomic<bool> running{false};
+  std::atomic<bool> recording{false};
+  std::atomic<long long> droppedBlocks{0};
+  std::atomic<uint64_t> framesWritten{0};
+};
@@ -0,0 +1,146 @@
+/*
+Implementation of a Standard MIDI File (type 0 and 1) reader.
+Channel events from every track are merged and converted from ticks to
+seconds using the file's tempo map, ready for MidiScheduler::setSequence.
+Meta and sysex events other than tempo are skipped.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "../Control/MidiScheduler.cpp"
+
+class MidiFile {
+public:
+  bool load (const char* path) {
+    events.clear();
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) { return false; }
+    std::vector<unsigned char> data;
+    unsigned char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+      data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return parse(data);
+  }
+
+  const std::vector<MidiEvent>& getEvents () const {return events;}
+
+private:
+  struct TickEvent {
+    long long tick;
+    int order; // <- keeps file order for events on the same tick
+    bool isTempo;
+    double microsPerQuarter;
+    MidiEvent event;
+  };
+
+  static unsigned readBE (const unsigned char* p, int bytes) {
+    unsigned value = 0;
+    for (int i = 0; i < bytes; i++) { value = (value << 8) | p[i]; }
+    return value;
+  }
+
+  bool parse (const std::vector<unsigned char>& data) {
+    if (data.size() < 14 || readBE(&data[0], 4) != 0x4D546864) { return false; } // "MThd"
+    int numTracks = readBE(&data[10], 2);
+    int division = static_cast<short>(readBE(&data[12], 2));
+    size_t pos = 8 + readBE(&data[4], 4);
+
+    std::vector<TickEvent> merged;
+    for (int track = 0; track < numTracks && pos + 8 <= data.size(); track++) {
+      size_t length = readBE(&data[pos + 4], 4);
+      size_t start = pos + 8;
+      size_t end = std::min(start + length, data.size());
+      if (readBE(&data[pos], 4) == 0x4D54726B) { parseTrack(data, start, end, merged); } // "MTrk"
+      pos = end;
+    }
+    std::sort(merged.begin(), merged.end(), [](const TickEvent& a, const TickEvent& b) {
+      return a.tick != b.tick ? a.tick < b.tick : a.order < b.order;
+    });
+
+    // ticks -> seconds through the tempo map
+    double secondsPerTick;
+    if (division > 0) {
+      secondsPerTick = 500000.0 / 1e6 / division; // <- 120 bpm until told otherwise
+    } else { // SMPTE: -frames per second in the high byte, ticks per frame in the low
+      secondsPerTick = 1.0 / (-(division >> 8) * (division & 0xFF));
+    }
+    long long lastTick = 0;
+    double seconds = 0.0;
+    for (const TickEvent& e : merged) {
+      seconds += (e.tick - lastTick) * secondsPerTick;
+      lastTick = e.tick;
+      if (e.isTempo) {
+        if (division > 0) { secondsPerTick = e.microsPerQuarter / 1e6 / division; }
+      } else {
+        MidiEvent event = e.event;
+        event.time = seconds;
+        events.push_back(event);
+      }
+    }
+    return true;
+  }
+
+  void parseTrack (const std::vector<unsigned char>& data, size_t pos, size_t end,
+                   std::vector<TickEvent>& merged) {
+    long long tick = 0;
+    unsigned char runningStatus = 0;
+    while (pos < end) {
+      tick += readVarLen(data, pos, end);
+      if (pos >= end) { break; }
+      unsigned char status = data[pos];
+      if (status == 0xFF) { // meta
+        if (pos + 2 > end) { break; }
+        unsigned char metaType = data[pos + 1];
+        pos += 2;
+        size_t length = readVarLen(data, pos, end);
+        if (metaType == 0x51 && length == 3 && pos + 3 <= end) {
+          TickEvent tempo{tick, static_cast<int>(merged.size()), true,
+            static_cast<double>(readBE(&data[pos], 3)), MidiEvent()};
+          merged.push_back(tempo);
+        }
+        if (metaType == 0x2F) { break; } // end of track
+        pos += length;
+        continue;
+      }
+      if (status == 0xF0 || status == 0xF7) { // sysex
+        pos++;
+        pos += readVarLen(data, pos, end);
+        continue;
+      }
+      if (status & 0x80) {
+        runningStatus = status;
+        pos++;
+      } else if (runningStatus == 0) {
+        break; // <- data byte with no status, corrupt track
+      }
+      int type = runningStatus & 0xF0;
+      int numData = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+      if (pos + numData > end) { break; }
+      TickEvent e{tick, static_cast<int>(merged.size()), false, 0.0, MidiEvent()};
+      e.event.status = runningStatus;
+      e.event.data1 = data[pos];
+      e.event.data2 = numData == 2 ? data[pos + 1] : 0;
+      merged.push_back(e);
+      pos += numData;
+    }
+  }
+
+  static size_t readVarLen (const std::vector<unsigned char>& data, size_t& pos, size_t end) {
+    size_t value = 0;
+    for (int i = 0; i < 4 && pos < end; i++) {
+      unsigned char byte = data[pos++];
+      value = (value << 7) | (byte & 0x7F);
+      if (!(byte & 0x80)) { break; }
+    }
+    return value;
+  }
+
+  std::vector<MidiEvent> events;
+};
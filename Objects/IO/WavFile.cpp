@@ -0,0 +1,225 @@
+/*
+Implementation of streaming WAV file reading and writing.
+
+WavReader reads 16/24/32-bit PCM and 32-bit float files and returns
+interleaved floats a block at a time. WavWriter writes 32-bit float or
+16-bit PCM and fills in the header sizes in close(), switching to RF64
+if the data passed 4 GB. Conversion scratch grows to the block size on
+the first read() or write() that needs it, then is reused, so a worker
+can stream files of any length through fixed buffers. Don't make that
+first call on the audio thread. 16-bit conversion goes through the
+dispatched kernels, so this needs DSPCore linked.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../Kernels/DSPKernels.cpp"
+
+class WavReader {
+public:
+  ~WavReader () {close();}
+
+  bool open (const char* path) {
+    close();
+    file = fopen(path, "rb");
+    if (file == nullptr) { return false; }
+    unsigned char header[12];
+    if (fread(header, 1, 12, file) != 12 ||
+        (memcmp(header, "RIFF", 4) != 0 && memcmp(header, "RF64", 4) != 0) ||
+        memcmp(header + 8, "WAVE", 4) != 0) {
+      close();
+      return false;
+    }
+    uint64_t rf64DataSize = 0;
+    unsigned char chunk[8];
+    while (fread(chunk, 1, 8, file) == 8) {
+      uint32_t size = le32(chunk + 4);
+      if (memcmp(chunk, "fmt ", 4) == 0) {
+        unsigned char fmt[40] = {};
+        size_t toRead = size < sizeof(fmt) ? size : sizeof(fmt);
+        if (fread(fmt, 1, toRead, file) != toRead) { break; }
+        if (size > toRead) { fseek(file, size - toRead, SEEK_CUR); }
+        format = le16(fmt);
+        channels = le16(fmt + 2);
+        sampleRate = le32(fmt + 4);
+        bitsPerSample = le16(fmt + 14);
+        if (format == 0xFFFE && toRead >= 26) { format = le16(fmt + 24); } // <- extensible
+      } else if (memcmp(chunk, "ds64", 4) == 0) {
+        unsigned char ds64[28] = {};
+        size_t toRead = size < sizeof(ds64) ? size : sizeof(ds64);
+        if (fread(ds64, 1, toRead, file) != toRead) { break; }
+        if (size > toRead) { fseek(file, size - toRead, SEEK_CUR); }
+        rf64DataSize = le32(ds64 + 8) | (static_cast<uint64_t>(le32(ds64 + 12)) << 32);
+      } else if (memcmp(chunk, "data", 4) == 0) {
+        uint64_t dataSize = (size == 0xFFFFFFFF && rf64DataSize > 0) ? rf64DataSize : size;
+        bytesPerFrame = channels * (bitsPerSample / 8);
+        if (bytesPerFrame == 0 || !supported()) { break; }
+        totalFrames = dataSize / bytesPerFrame;
+        framesLeft = totalFrames;
+        return true;
+      } else {
+        fseek(file, size + (size & 1), SEEK_CUR); // <- chunks are word aligned
+      }
+    }
+    close();
+    return false;
+  }
+
+  // reads up to numFrames interleaved frames, returns frames read
+  int read (float* output, int numFrames) {
+    if (file == nullptr) { return 0; }
+    if (static_cast<uint64_t>(numFrames) > framesLeft) { numFrames = static_cast<int>(framesLeft); }
+    size_t bytes = static_cast<size_t>(numFrames) * bytesPerFrame;
+    if (format == 1 && bitsPerSample == 16) { // <- fast path, little-endian hosts only
+      size_t samplesWanted = static_cast<size_t>(numFrames) * channels;
+      if (pcm16.size() < samplesWanted) { pcm16.resize(samplesWanted); }
+      size_t got = fread(pcm16.data(), bytesPerFrame, numFrames, file);
+      dspKernels().pcm16ToFloat(pcm16.data(), output, static_cast<int>(got) * channels);
+      framesLeft -= got;
+      return static_cast<int>(got);
+    }
+    if (raw.size() < bytes) { raw.resize(bytes); } // <- grows once to the block size
+    size_t got = fread(raw.data(), 1, bytes, file) / bytesPerFrame;
+    int samples = static_cast<int>(got) * channels;
+    const unsigned char* p = raw.data();
+    for (int i = 0; i < samples; i++) {
+      if (format == 3) {
+        memcpy(&output[i], p + 4 * i, 4);
+      } else if (bitsPerSample == 24) {
+        const unsigned char* s = p + 3 * i;
+        int32_t v = (s[0] << 8) | (s[1] << 16) | (s[2] << 24);
+        output[i] = (v >> 8) / 8388608.f;
+      } else {
+        output[i] = static_cast<int32_t>(le32(p + 4 * i)) / 2147483648.f;
+      }
+    }
+    framesLeft -= got;
+    return static_cast<int>(got);
+  }
+
+  void close () {
+    if (file != nullptr) { fclose(file); file = nullptr; }
+  }
+
+  int getChannels () const {return channels;}
+  int getSampleRate () const {return sampleRate;}
+  uint64_t getFrames () const {return totalFrames;}
+
+private:
+  bool supported () const {
+    return (format == 1 && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32)) ||
+      (format == 3 && bitsPerSample == 32);
+  }
+
+  static uint16_t le16 (const unsigned char* p) {return p[0] | (p[1] << 8);}
+  static uint32_t le32 (const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  FILE* file = nullptr;
+  int format = 0;
+  int channels = 0;
+  int sampleRate = 0;
+  int bitsPerSample = 0;
+  int bytesPerFrame = 0;
+  uint64_t totalFrames = 0;
+  uint64_t framesLeft = 0;
+  std::vector<unsigned char> raw;
+  std::vector<int16_t> pcm16;
+};
+
+class WavWriter {
+public:
+  enum Format {FLOAT32, PCM16};
+
+  ~WavWriter () {close();}
+
+  bool open (const char* path, int numChannels, int samprate, Format fmt = FLOAT32) {
+    close();
+    file = fopen(path, "wb");
+    if (file == nullptr) { return false; }
+    channels = numChannels;
+    sampleRate = samprate;
+    format = fmt;
+    dataBytes = 0;
+    writeHeader(); // <- placeholder sizes, fixed up in close()
+    return true;
+  }
+
+  // writes numFrames interleaved frames
+  bool write (const float* input, int numFrames) {
+    if (file == nullptr) { return false; }
+    int samples = numFrames * channels;
+    size_t bytes;
+    if (format == FLOAT32) {
+      bytes = fwrite(input, 4, samples, file) * 4; // <- little-endian hosts only
+    } else {
+      if (raw.size() < static_cast<size_t>(samples)) { raw.resize(samples); }
+      dspKernels().floatToPcm16(input, raw.data(), samples);
+      bytes = fwrite(raw.data(), 2, samples, file) * 2;
+    }
+    dataBytes += bytes;
+    return bytes == static_cast<size_t>(samples) * bytesPerSample();
+  }
+
+  // rewrites the header with the final sizes; false if any of it didn't reach the disk
+  bool close () {
+    if (file == nullptr) { return true; } // <- nothing open, nothing lost
+    if (dataBytes & 1) { fputc(0, file); } // <- pad byte
+    bool ok = fseek(file, 0, SEEK_SET) == 0;
+    writeHeader();
+    ok = ferror(file) == 0 && ok;
+    ok = fclose(file) == 0 && ok; // <- flushes the buffer, so a full disk can show up only here
+    file = nullptr;
+    return ok;
+  }
+
+  uint64_t getFramesWritten () const {return dataBytes / (bytesPerSample() * channels);}
+
+private:
+  int bytesPerSample () const {return format == FLOAT32 ? 4 : 2;}
+
+  // RIFF header with a JUNK chunk reserved so it can become RF64 in place
+  void writeHeader () {
+    bool rf64 = dataBytes > 0xFFFFFFFFull - 80;
+    uint64_t riffSize = 4 + (8 + 28) + (8 + 16) + 8 + dataBytes + (dataBytes & 1);
+    unsigned char h[80] = {};
+    memcpy(h, rf64 ? "RF64" : "RIFF", 4);
+    put32(h + 4, rf64 ? 0xFFFFFFFF : static_cast<uint32_t>(riffSize));
+    memcpy(h + 8, "WAVE", 4);
+    memcpy(h + 12, rf64 ? "ds64" : "JUNK", 4);
+    put32(h + 16, 28);
+    if (rf64) {
+      put64(h + 20, riffSize);
+      put64(h + 28, dataBytes);
+      put64(h + 36, dataBytes / (bytesPerSample() * channels));
+    }
+    memcpy(h + 48, "fmt ", 4);
+    put32(h + 52, 16);
+    put16(h + 56, format == FLOAT32 ? 3 : 1);
+    put16(h + 58, channels);
+    put32(h + 60, sampleRate);
+    put32(h + 64, sampleRate * channels * bytesPerSample());
+    put16(h + 68, channels * bytesPerSample());
+    put16(h + 70, bytesPerSample() * 8);
+    memcpy(h + 72, "data", 4);
+    put32(h + 76, rf64 ? 0xFFFFFFFF : static_cast<uint32_t>(dataBytes));
+    fwrite(h, 1, sizeof(h), file);
+  }
+
+  static void put16 (unsigned char* p, uint32_t v) {p[0] = v; p[1] = v >> 8;}
+  static void put32 (unsigned char* p, uint32_t v) {put16(p, v); put16(p + 2, v >> 16);}
+  static void put64 (unsigned char* p, uint64_t v) {put32(p, static_cast<uint32_t>(v)); put32(p + 4, v >> 32);}
+
+  FILE* file = nullptr;
+  int channels = 0;
+  int sampleRate = 0;
+  Format format = FLOAT32;
+  uint64_t dataBytes = 0;
+  std::vector<int16_t> raw;
+};
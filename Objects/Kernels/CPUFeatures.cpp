@@ -0,0 +1,78 @@
+/*
+CPU feature detection for kernel dispatch.
+
+Asks CPUID what the processor supports and XGETBV whether the OS saves
+the matching register state, because an AVX-capable CPU under an OS that
+doesn't save ymm/zmm registers still can't run AVX code. Detection runs
+once; get() is cheap after that. Everything reads false off x86.
+*/
+
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DSP_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+struct CPUFeatures {
+  bool sse2 = false;
+  bool avx2 = false; // <- AVX2 + FMA, with OS support for ymm state
+  bool avx512 = false; // <- AVX-512 F/BW/DQ/VL, with OS support for zmm state
+
+  static const CPUFeatures& get () {
+    static const CPUFeatures features = detect();
+    return features;
+  }
+
+private:
+  static CPUFeatures detect () {
+    CPUFeatures f;
+#ifdef DSP_X86
+    unsigned int regs[4] = {}; // <- eax, ebx, ecx, edx
+    cpuid(0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1) { return f; }
+    cpuid(1, regs);
+    f.sse2 = (regs[3] >> 26) & 1;
+    bool fma = (regs[2] >> 12) & 1;
+    bool osxsave = (regs[2] >> 27) & 1;
+    bool avx = (regs[2] >> 28) & 1;
+    if (!osxsave || !avx || maxLeaf < 7) { return f; }
+    unsigned long long xcr0 = xgetbv();
+    bool ymmState = (xcr0 & 0x6) == 0x6; // <- SSE and AVX state
+    bool zmmState = (xcr0 & 0xE6) == 0xE6; // <- plus opmask and upper zmm
+    cpuid(7, regs);
+    unsigned int ebx = regs[1];
+    f.avx2 = ymmState && fma && ((ebx >> 5) & 1);
+    bool avx512 = ((ebx >> 16) & 1) && ((ebx >> 17) & 1) && ((ebx >> 30) & 1) && ((ebx >> 31) & 1);
+    f.avx512 = f.avx2 && zmmState && avx512;
+#endif
+    return f;
+  }
+
+#ifdef DSP_X86
+  static void cpuid (unsigned int leaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), 0);
+    for (int i = 0; i < 4; i++) { regs[i] = static_cast<unsigned int>(r[i]); }
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+  }
+
+  static unsigned long long xgetbv () {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0)); // <- no -mxsave needed
+    return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+  }
+#endif
+};
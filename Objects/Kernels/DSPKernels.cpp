@@ -0,0 +1,49 @@
+/*
+Interface to the runtime-dispatched DSP kernels in DSPCore.
+
+The kernels are compiled once per instruction set (SSE2, AVX2, AVX-512
+on x86, generic elsewhere) from KernelsImpl.cpp. Dispatch.cpp picks the
+widest set the CPU and OS support the first time dspKernels() is called,
+so one binary runs at full width on every machine. Call it once from
+setup code so detection doesn't land on the audio thread.
+
+All sets give bit-identical results: kernels are built without FMA
+contraction and reductions use a fixed 16-lane order.
+
+Set DSP_KERNELS=generic|sse2|avx2|avx512 in the environment, or call
+selectKernels(), to force a set for comparisons.
+
+Needs DSPCore to be linked, unlike the header-only objects.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+struct DSPKernels {
+  const char* name;
+  // in place: buffer *= linear ramp from startGain to endGain
+  void (*gainRamp)(float* buffer, int numSamples, float startGain, float endGain);
+  // in place: buffer *= ramp interpolated in dB
+  void (*gainRampdB)(float* buffer, int numSamples, float startdB, float enddB);
+  void (*dBtoA)(const float* dB, float* amp, int numSamples);
+  void (*ampTodB)(const float* amp, float* dB, int numSamples);
+  float (*sumOfSquares)(const float* input, int numSamples);
+  float (*peak)(const float* input, int numSamples); // <- max |x|
+  void (*pcm16ToFloat)(const int16_t* input, float* output, int numSamples);
+  void (*floatToPcm16)(const float* input, int16_t* output, int numSamples); // <- clamps
+  void (*floatToHalf)(const float* input, uint16_t* output, int numSamples); // <- float16 bits, see HalfFloat.cpp
+  void (*halfToFloat)(const uint16_t* input, float* output, int numSamples);
+  // output[k] = sum of reference[n] x input[k + n] over n < length, for k < numLags;
+  // input holds length + numLags - 1 samples
+  void (*crossCorrelate)(const float* reference, int length, const float* input, float* output, int numLags);
+  // one radix 2/3/4/5 Stockham FFT pass on split complex data, see FFT.cpp
+  void (*fftPass)(int radix, int m, int stride, const float* twiddleRe, const float* twiddleIm,
+    const float* inRe, const float* inIm, float* outRe, float* outIm);
+};
+
+// active kernel set, detected on first call
+const DSPKernels& dspKernels ();
+
+// force a set by name, false if it wasn't built or the CPU can't run it
+bool selectKernels (const char* name);
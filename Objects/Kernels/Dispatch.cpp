@@ -0,0 +1,74 @@
+/*
+Picks the kernel set for this machine. Compiled into DSPCore; the build
+defines DSP_HAVE_SSE2 / DSP_HAVE_AVX2 / DSP_HAVE_AVX512 for the sets it
+compiled, or DSP_HAVE_GENERIC off x86.
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "DSPKernels.cpp"
+#include "CPUFeatures.cpp"
+
+#ifdef DSP_HAVE_GENERIC
+extern const DSPKernels dspKernels_generic;
+#endif
+#ifdef DSP_HAVE_SSE2
+extern const DSPKernels dspKernels_sse2;
+#endif
+#ifdef DSP_HAVE_AVX2
+extern const DSPKernels dspKernels_avx2;
+#endif
+#ifdef DSP_HAVE_AVX512
+extern const DSPKernels dspKernels_avx512;
+#endif
+
+namespace {
+
+// nullptr if the set wasn't built or this CPU can't run it
+const DSPKernels* findKernels (const char* name) {
+  const CPUFeatures& cpu = CPUFeatures::get();
+  (void)cpu;
+#ifdef DSP_HAVE_AVX512
+  if (strcmp(name, "avx512") == 0) { return cpu.avx512 ? &dspKernels_avx512 : nullptr; }
+#endif
+#ifdef DSP_HAVE_AVX2
+  if (strcmp(name, "avx2") == 0) { return cpu.avx2 ? &dspKernels_avx2 : nullptr; }
+#endif
+#ifdef DSP_HAVE_SSE2
+  if (strcmp(name, "sse2") == 0) { return cpu.sse2 ? &dspKernels_sse2 : nullptr; }
+#endif
+#ifdef DSP_HAVE_GENERIC
+  if (strcmp(name, "generic") == 0) { return &dspKernels_generic; }
+#endif
+  return nullptr;
+}
+
+const DSPKernels* bestKernels () {
+  const char* forced = getenv("DSP_KERNELS");
+  if (forced != nullptr && findKernels(forced) != nullptr) { return findKernels(forced); }
+  const char* widestFirst[] = {"avx512", "avx2", "sse2", "generic"};
+  for (const char* name : widestFirst) {
+    if (const DSPKernels* kernels = findKernels(name)) { return kernels; }
+  }
+  return nullptr; // <- unreachable: the build always compiles sse2 or generic
+}
+
+std::atomic<const DSPKernels*>& active () {
+  static std::atomic<const DSPKernels*> kernels{bestKernels()};
+  return kernels;
+}
+
+} // namespace
+
+const DSPKernels& dspKernels () {
+  return *active().load(std::memory_order_acquire);
+}
+
+bool selectKernels (const char* name) {
+  const DSPKernels* kernels = findKernels(name);
+  if (kernels == nullptr) { return false; }
+  active().store(kernels, std::memory_order_release);
+  return true;
+}
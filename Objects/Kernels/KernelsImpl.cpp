@@ -0,0 +1,230 @@
+/*
+Kernel bodies, compiled into DSPCore once per instruction set.
+
+The build compiles this file several times with DSP_KERNEL_ISA set to
+the set's name (sse2, avx2, avx512, generic) and the matching -m flags.
+Each pass defines one table, dspKernels_<isa>. The loops are plain C++
+written so the compiler vectorizes them to whatever width it is
+targeting. Don't #include this file; use DSPKernels.cpp.
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "DSPKernels.cpp"
+
+#ifndef DSP_KERNEL_ISA
+#define DSP_KERNEL_ISA generic
+#endif
+
+// internal linkage: each pass gets its own copy of the inline math,
+// so the linker can't hand AVX code to the SSE2 table
+namespace {
+
+#include "../Utility/FastMath.cpp"
+#include "../Utility/HalfFloat.cpp"
+
+const int lanes = 16; // <- fixed reduction order, same result at every width
+
+float sumOfSquaresKernel (const float* input, int numSamples) {
+  float acc[lanes] = {};
+  int i = 0;
+  for (; i + lanes <= numSamples; i += lanes) {
+    for (int l = 0; l < lanes; l++) { acc[l] += input[i + l] * input[i + l]; }
+  }
+  for (int l = 0; i < numSamples; i++, l++) { acc[l] += input[i] * input[i]; }
+  float sum = 0.f;
+  for (int l = 0; l < lanes; l++) { sum += acc[l]; }
+  return sum;
+}
+
+float peakKernel (const float* input, int numSamples) {
+  float acc[lanes] = {};
+  int i = 0;
+  for (; i + lanes <= numSamples; i += lanes) {
+    for (int l = 0; l < lanes; l++) {
+      float level = fabsf(input[i + l]);
+      acc[l] = level > acc[l] ? level : acc[l];
+    }
+  }
+  float result = 0.f;
+  for (; i < numSamples; i++) { result = fabsf(input[i]) > result ? fabsf(input[i]) : result; }
+  for (int l = 0; l < lanes; l++) { result = acc[l] > result ? acc[l] : result; }
+  return result;
+}
+
+void pcm16ToFloatKernel (const int16_t* input, float* output, int numSamples) {
+  for (int i = 0; i < numSamples; i++) { output[i] = input[i] * (1.f / 32768.f); }
+}
+
+// the inverse of pcm16ToFloat: same 32768 scale, rounded to nearest so a round trip is exact
+void floatToPcm16Kernel (const float* input, int16_t* output, int numSamples) {
+  for (int i = 0; i < numSamples; i++) {
+    float x = input[i] * 32768.f;
+    x = x < -32768.f ? -32768.f : (x > 32767.f ? 32767.f : x);
+    x = (x + 12582912.f) - 12582912.f; // <- + 1.5 x 2^23 rounds to nearest even, no libm call
+    output[i] = static_cast<int16_t>(static_cast<int>(x));
+  }
+}
+
+// stores output k of a butterfly, times its twiddle when k > 0
+inline void fftPut (int k, float xr, float xi, float* __restrict yr, float* __restrict yi, int jump,
+  const float* __restrict wr, const float* __restrict wi, int twiddleJump) {
+  if (k == 0) {
+    yr[0] = xr;
+    yi[0] = xi;
+    return;
+  }
+  float cr = wr[(k - 1) * twiddleJump], ci = wi[(k - 1) * twiddleJump];
+  yr[k * jump] = xr * cr - xi * ci;
+  yi[k * jump] = xr * ci + xi * cr;
+}
+
+// DFT of R points spaced jump apart, forward sign, outputs spaced outJump
+// apart; written out with no inner loops so the loop around it vectorizes
+template<int R>
+inline void fftButterfly (const float* __restrict xr, const float* __restrict xi, int jump,
+  float* __restrict yr, float* __restrict yi, int outJump,
+  const float* __restrict wr, const float* __restrict wi, int twiddleJump) {
+#define FFT_PUT(k, re, im) fftPut(k, re, im, yr, yi, outJump, wr, wi, twiddleJump)
+  if constexpr (R == 2) {
+    float a0r = xr[0], a0i = xi[0], a1r = xr[jump], a1i = xi[jump];
+    FFT_PUT(0, a0r + a1r, a0i + a1i);
+    FFT_PUT(1, a0r - a1r, a0i - a1i);
+  } else if constexpr (R == 3) {
+    const float h = 0.866025404f; // <- sin(2 pi / 3)
+    float a0r = xr[0], a0i = xi[0];
+    float sr = xr[jump] + xr[2 * jump], si = xi[jump] + xi[2 * jump];
+    float dr = xr[jump] - xr[2 * jump], di = xi[jump] - xi[2 * jump];
+    float mr = a0r - 0.5f * sr, mi = a0i - 0.5f * si;
+    FFT_PUT(0, a0r + sr, a0i + si);
+    FFT_PUT(1, mr + h * di, mi - h * dr);
+    FFT_PUT(2, mr - h * di, mi + h * dr);
+  } else if constexpr (R == 4) {
+    float a0r = xr[0], a0i = xi[0], a1r = xr[jump], a1i = xi[jump];
+    float a2r = xr[2 * jump], a2i = xi[2 * jump], a3r = xr[3 * jump], a3i = xi[3 * jump];
+    float t0r = a0r + a2r, t0i = a0i + a2i;
+    float t1r = a0r - a2r, t1i = a0i - a2i;
+    float t2r = a1r + a3r, t2i = a1i + a3i;
+    float t3r = a1i - a3i, t3i = a3r - a1r; // <- (a1 - a3) * -i
+    FFT_PUT(0, t0r + t2r, t0i + t2i);
+    FFT_PUT(1, t1r + t3r, t1i + t3i);
+    FFT_PUT(2, t0r - t2r, t0i - t2i);
+    FFT_PUT(3, t1r - t3r, t1i - t3i);
+  } else {
+    const float c1 = 0.309016994f, c2 = -0.809016994f; // <- cos(2 pi / 5), cos(4 pi / 5)
+    const float s1 = 0.951056516f, s2 = 0.587785252f;
+    float a0r = xr[0], a0i = xi[0];
+    float b1r = xr[jump] + xr[4 * jump], b1i = xi[jump] + xi[4 * jump];
+    float b2r = xr[2 * jump] + xr[3 * jump], b2i = xi[2 * jump] + xi[3 * jump];
+    float d1r = xr[jump] - xr[4 * jump], d1i = xi[jump] - xi[4 * jump];
+    float d2r = xr[2 * jump] - xr[3 * jump], d2i = xi[2 * jump] - xi[3 * jump];
+    float r1r = a0r + c1 * b1r + c2 * b2r, r1i = a0i + c1 * b1i + c2 * b2i;
+    float r2r = a0r + c2 * b1r + c1 * b2r, r2i = a0i + c2 * b1i + c1 * b2i;
+    float i1r = s1 * d1r + s2 * d2r, i1i = s1 * d1i + s2 * d2i;
+    float i2r = s2 * d1r - s1 * d2r, i2i = s2 * d1i - s1 * d2i;
+    FFT_PUT(0, a0r + b1r + b2r, a0i + b1i + b2i);
+    FFT_PUT(1, r1r + i1i, r1i - i1r);
+    FFT_PUT(2, r2r + i2i, r2i - i2r);
+    FFT_PUT(3, r2r - i2i, r2i + i2r);
+    FFT_PUT(4, r1r - i1i, r1i + i1r);
+  }
+#undef FFT_PUT
+}
+
+// one column of butterflies sharing twiddles: vectorized across q. The
+// outputs of different q never overlap, but with a runtime stride GCC can't
+// prove it and gives up on the alias checks, hence ivdep
+template<int R>
+inline void fftColumn (int s, int jump, const float* __restrict wr, const float* __restrict wi,
+  const float* __restrict inR, const float* __restrict inI, float* __restrict outR, float* __restrict outI) {
+#pragma GCC ivdep
+  for (int q = 0; q < s; q++) {
+    fftButterfly<R>(inR + q, inI + q, jump, outR + q, outI + q, s, wr, wi, 1);
+  }
+}
+
+// first pass (stride 1): vectorized across p, twiddles are contiguous in p
+template<int R>
+inline void fftFirstPass (int m, const float* __restrict twRe, const float* __restrict twIm,
+  const float* __restrict xr, const float* __restrict xi, float* __restrict yr, float* __restrict yi) {
+#pragma GCC ivdep
+  for (int p = 0; p < m; p++) {
+    fftButterfly<R>(xr + p, xi + p, m, yr + R * p, yi + R * p, 1, twRe + p, twIm + p, m);
+  }
+}
+
+// y[q + s(Rp + k)] = w^(pk) DFT_R(x[q + s(p + jm)])_k; the passes never run in place
+template<int R>
+void fftPassRadix (int m, int s, const float* __restrict twRe, const float* __restrict twIm,
+  const float* __restrict xr, const float* __restrict xi, float* __restrict yr, float* __restrict yi) {
+  if (s == 1) {
+    fftFirstPass<R>(m, twRe, twIm, xr, xi, yr, yi);
+    return;
+  }
+  for (int p = 0; p < m; p++) {
+    float wr[R], wi[R];
+    for (int k = 1; k < R; k++) { wr[k - 1] = twRe[(k - 1) * m + p]; wi[k - 1] = twIm[(k - 1) * m + p]; }
+    fftColumn<R>(s, s * m, wr, wi, xr + s * p, xi + s * p, yr + s * R * p, yi + s * R * p);
+  }
+}
+
+// vectorized across lags, so each lag sums in the same order at every width
+void crossCorrelateKernel (const float* reference, int length, const float* input, float* output, int numLags) {
+  float* __restrict out = output;
+  for (int k = 0; k < numLags; k++) { out[k] = 0.f; }
+  int n = 0;
+  for (; n + 4 <= length; n += 4) { // <- four reference taps per pass over the lags
+    float r0 = reference[n], r1 = reference[n + 1], r2 = reference[n + 2], r3 = reference[n + 3];
+    const float* __restrict x = input + n;
+    for (int k = 0; k < numLags; k++) {
+      float sum = out[k];
+      sum += r0 * x[k];
+      sum += r1 * x[k + 1];
+      sum += r2 * x[k + 2];
+      sum += r3 * x[k + 3];
+      out[k] = sum;
+    }
+  }
+  for (; n < length; n++) {
+    float r = reference[n];
+    const float* __restrict x = input + n;
+    for (int k = 0; k < numLags; k++) { out[k] += r * x[k]; }
+  }
+}
+
+void fftPassKernel (int radix, int m, int stride, const float* twiddleRe, const float* twiddleIm,
+  const float* inRe, const float* inIm, float* outRe, float* outIm) {
+  switch (radix) {
+    case 2: fftPassRadix<2>(m, stride, twiddleRe, twiddleIm, inRe, inIm, outRe, outIm); break;
+    case 3: fftPassRadix<3>(m, stride, twiddleRe, twiddleIm, inRe, inIm, outRe, outIm); break;
+    case 4: fftPassRadix<4>(m, stride, twiddleRe, twiddleIm, inRe, inIm, outRe, outIm); break;
+    case 5: fftPassRadix<5>(m, stride, twiddleRe, twiddleIm, inRe, inIm, outRe, outIm); break;
+    default: break; // <- other radices run in FFT.cpp
+  }
+}
+
+} // namespace
+
+#define DSP_KERNEL_CONCAT2(a, b) a##b
+#define DSP_KERNEL_CONCAT(a, b) DSP_KERNEL_CONCAT2(a, b)
+#define DSP_KERNEL_STRING2(a) #a
+#define DSP_KERNEL_STRING(a) DSP_KERNEL_STRING2(a)
+
+extern const DSPKernels DSP_KERNEL_CONCAT(dspKernels_, DSP_KERNEL_ISA);
+const DSPKernels DSP_KERNEL_CONCAT(dspKernels_, DSP_KERNEL_ISA) = {
+  DSP_KERNEL_STRING(DSP_KERNEL_ISA),
+  gainRamp,
+  gainRampdB,
+  dBtoABlock,
+  ampTodBBlock,
+  sumOfSquaresKernel,
+  peakKernel,
+  pcm16ToFloatKernel,
+  floatToPcm16Kernel,
+  floatToHalfBlock,
+  halfToFloatBlock,
+  crossCorrelateKernel,
+  fftPassKernel,
+};
@@ -0,0 +1,39 @@
+/*
+Implementation of a basic phase accumulator.
+Generates a unipolar ramp wave from 0 to 1 with adjustable frequency.
+*/
+
+#pragma once
+
+#include <cmath>
+
+class Phasor {
+public:
+  Phasor (int samprate) : sampleRate(samprate) {}
+  virtual ~Phasor () = default;
+
+  virtual void setSampleRate (int samprate) {
+    sampleRate = samprate;
+    phaseIncrement = frequency / static_cast<float> (sampleRate);
+  }
+
+  virtual void setFrequency (float freq) {
+    frequency = freq;
+    phaseIncrement = frequency / static_cast<float> (sampleRate);
+  }
+
+  virtual float processSample() {
+    phase += phaseIncrement;
+    phase = fmod(phase, 1.f);
+    return phase;
+  }
+
+  virtual void setPhase (float ph) {phase = ph;}
+  virtual float getPhase () {return phase;}
+
+protected:
+  float phase = 0.f;
+  int sampleRate = 44100;
+  float frequency = 1.f;
+  float phaseIncrement = frequency / static_cast<float>(sampleRate);
+};
@@ -0,0 +1,121 @@
+/*
+Implementation of a bank of oscillators tuned to a harmonic series.
+Voice i runs at (i + 1) * frequency. T must construct from a sample rate
+and provide setFrequency, processSample, setPhase and getPhase.
+
+In harmonic mode the bank of T is bypassed: one rotating complex phasor
+gives cos/sin of the fundamental each sample, and every partial is built
+from it with the Chebyshev recurrence sin(kx) = 2cos(x)sin((k-1)x) - sin((k-2)x).
+That is one multiply-add per partial instead of one sine per voice, the
+partials can't drift apart so no phase resync is needed, and the phasor
+is renormalized every renormInterval samples to keep it on the unit circle.
+Partials at or above Nyquist are skipped.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+template<typename T>
+class PolyphonyEngine {
+public:
+  PolyphonyEngine (int voices, int samprate) : 
+  numVoices(voices), sampleRate(samprate) {}
+
+  void prepare () {
+    for (int i = 0; i < numVoices; i++) {
+      oscBank.push_back(T (sampleRate));
+    }
+    amplitudes.assign(numVoices, 1.f);
+  }
+
+  void setFrequency(float freq) {
+    for (int i = 0; i < numVoices; i++) {
+      oscBank[i].setFrequency((i + 1) * freq);
+    }
+    float omega = 2.f * static_cast<float>(M_PI) * freq / sampleRate;
+    rotCos = cosf(omega);
+    rotSin = sinf(omega);
+    activePartials = numVoices;
+    if (freq > 0.f) { // <- drop partials at or above nyquist
+      int below = static_cast<int>(ceilf(0.5f * sampleRate / freq)) - 1;
+      if (below < activePartials) { activePartials = below > 0 ? below : 0; }
+    }
+  }
+
+  // voice i of the bank, e.g. to load a table into each WavetableOsc after prepare()
+  T& getVoice (int i) {return oscBank[i];}
+  int getNumVoices () const {return numVoices;}
+
+  void setHarmonicMode (bool on) {harmonicMode = on;}
+  bool getHarmonicMode () const {return harmonicMode;}
+
+  // per-partial gain for harmonic mode, partial 0 is the fundamental
+  void setPartialAmplitude (int partial, float amp) {
+    if (partial >= 0 && partial < static_cast<int>(amplitudes.size())) {
+      amplitudes[partial] = amp;
+    }
+  }
+
+  float processSample() {
+    if (harmonicMode) { return processHarmonics(); }
+    float output = 0.f;
+    for (int i = 0; i < numVoices; i++) {
+      output += oscBank[i].processSample();
+      if (i == 0) {
+        float diff = oscBank[i].getPhase() - last;
+        if (diff < 0) {
+          for (int j = 1; j < numVoices; j++) {
+            oscBank[j].setPhase(oscBank[i].getPhase());
+          }  
+        }
+      last = oscBank[i].getPhase();
+      }
+    }
+    return output * (1.f / numVoices); // <- should scale as a function of numVoices
+  }
+
+protected:
+  float processHarmonics () {
+    // advance the fundamental: z *= e^(i * omega)
+    float re = phasorCos * rotCos - phasorSin * rotSin;
+    float im = phasorCos * rotSin + phasorSin * rotCos;
+    phasorCos = re;
+    phasorSin = im;
+    if (++sinceRenorm >= renormInterval) { // first-order correction of |z| drift
+      float scale = 1.5f - 0.5f * (re * re + im * im);
+      phasorCos *= scale;
+      phasorSin *= scale;
+      sinceRenorm = 0;
+    }
+
+    float twoCos = 2.f * phasorCos;
+    float prev = 0.f; // sin(0x)
+    float current = phasorSin; // sin(1x)
+    float output = 0.f;
+    for (int k = 0; k < activePartials; k++) {
+      output += amplitudes[k] * current;
+      float next = twoCos * current - prev;
+      prev = current;
+      current = next;
+    }
+    return output * (1.f / numVoices);
+  }
+
+  int type;
+  int numVoices;
+  int sampleRate;
+  float last = 0.f;
+  std::vector<T> oscBank;
+
+  bool harmonicMode = false;
+  std::vector<float> amplitudes;
+  int activePartials = 0;
+  float rotCos = 1.f;
+  float rotSin = 0.f;
+  float phasorCos = 1.f;
+  float phasorSin = 0.f;
+  int sinceRenorm = 0;
+  static const int renormInterval = 64;
+};
@@ -0,0 +1,51 @@
+/*
+Implementation of a sine oscillator using an Nth-order Taylor series
+approximation, N adjustable, as seen in Gamma
+https://github.com/LancePutnam/Gamma
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include "Phasor.cpp"
+
+class SinOsc : public Phasor {
+public: 
+  SinOsc (int samprate) : Phasor(samprate) {}
+
+  float processSample() override {
+    phase += phaseIncrement;
+    phase = fmod(phase, 1.f);
+    return taylorNSin(phase * -twoPi + pi, N); // map phase to range (-pi,pi), calculate sin
+  }
+
+  void setOrder (int order) {N = order;}
+
+protected:
+  int N = 11; // 11 is good
+  const float pi = static_cast<float>(M_PI);
+  const float twoPi = 2.f * pi;
+
+  int factorial (int x) {
+    int output = 1;
+    int n = x;
+    while (n > 1) {
+      output *= n;
+      n -= 1;
+    }
+    return output;
+  }
+
+  float taylorNSin (float x, int order) {
+    float output = x;
+    int n = 3;
+    int sign = -1;
+    while (n <= order) {
+      output += sign * (powf(x, n) / factorial(n));
+      sign *= -1;
+      n += 2;
+    }
+    return output;
+  }
+};
@@ -0,0 +1,146 @@
+/*
+Implementation of a mipmapped, band-limited wavetable oscillator.
+
+A Wavetable takes one cycle of any waveform, of any length, and builds
+one table per octave at load time. It runs an FFT of the cycle, keeps
+harmonics 1..H for each level, and inverse-transforms onto tableSize
+samples. Level 0 keeps tableSize / 4 harmonics and every level above it
+keeps half as many, down to a sine. Building takes a few milliseconds,
+so load tables off the audio thread. A Wavetable is immutable once built
+and is shared between voices through a shared_ptr.
+
+WavetableOsc is a Phasor that reads the table. setFrequency() picks the
+brightest level whose top harmonic stays below Nyquist. Over the last
+quarter of each octave it crossfades into the next level, so a sweep
+never steps in timbre. The oscillator never aliases, and a voice costs
+one linearly interpolated table read per sample (two while crossfading).
+
+WavetableOsc constructs from a sample rate and starts on a sine, so it
+works as the T of PolyphonyEngine:
+
+  auto saw = std::make_shared<const Wavetable>(cycle.data(), cycle.size());
+  for (int i = 0; i < osc.getNumVoices(); i++) { osc.getVoice(i).setTable(saw); }
+*/
+
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "Phasor.cpp"
+#include "../Frequency-Domain/FFT.cpp"
+
+class Wavetable {
+public:
+  Wavetable (const float* cycle, int length, int size = 2048) :
+  tableSize(size < 16 ? 16 : size), topHarmonics(tableSize / 4) {
+    numLevels = 1;
+    while ((topHarmonics >> numLevels) >= 1) { numLevels++; }
+    tables.assign(numLevels * (tableSize + 1), 0.f);
+
+    RealFFT analysis(length);
+    std::vector<std::complex<float>> harmonics(analysis.getNumBins());
+    analysis.forward(cycle, harmonics.data());
+
+    RealFFT synthesis(tableSize);
+    std::vector<std::complex<float>> bins(synthesis.getNumBins());
+    float scale = static_cast<float>(tableSize) / length; // <- forward is unscaled, inverse is 1 / N
+    for (int level = 0; level < numLevels; level++) {
+      int keep = getHarmonics(level);
+      for (int k = 0; k < static_cast<int>(bins.size()); k++) {
+        bool kept = k < static_cast<int>(harmonics.size()) && k <= keep && 2 * k != length; // <- no input Nyquist bin
+        bins[k] = kept ? harmonics[k] * scale : std::complex<float>(0.f, 0.f);
+      }
+      float* table = tables.data() + level * (tableSize + 1);
+      synthesis.inverse(bins.data(), table);
+      table[tableSize] = table[0]; // <- guard sample for interpolation
+    }
+  }
+
+  int getTableSize () const {return tableSize;}
+  int getNumLevels () const {return numLevels;}
+  int getHarmonics (int level) const {return topHarmonics >> level;}
+  const float* getLevel (int level) const {return tables.data() + level * (tableSize + 1);}
+
+  // a single sine, what a WavetableOsc plays before setTable()
+  static std::shared_ptr<const Wavetable> sine () {
+    static std::shared_ptr<const Wavetable> table = [] {
+      float cycle[16];
+      for (int i = 0; i < 16; i++) { cycle[i] = sinf(2.f * static_cast<float>(M_PI) * i / 16.f); }
+      return std::make_shared<const Wavetable>(cycle, 16, 2048);
+    }();
+    return table;
+  }
+
+private:
+  int tableSize;
+  int topHarmonics;
+  int numLevels;
+  std::vector<float> tables; // <- numLevels x (tableSize + 1)
+};
+
+class WavetableOsc : public Phasor {
+public:
+  WavetableOsc (int samprate) : Phasor(samprate), wavetable(Wavetable::sine()) {
+    chooseLevels();
+  }
+
+  void setTable (std::shared_ptr<const Wavetable> table) {
+    if (!table) { return; }
+    wavetable = table;
+    chooseLevels();
+  }
+
+  void setSampleRate (int samprate) override {
+    Phasor::setSampleRate(samprate);
+    chooseLevels();
+  }
+
+  void setFrequency (float freq) override {
+    Phasor::setFrequency(freq);
+    chooseLevels();
+  }
+
+  float processSample () override {
+    phase += phaseIncrement;
+    phase -= floorf(phase); // <- also wraps negative frequencies
+    if (phase >= 1.f) { phase = 0.f; } // <- -tiny - floor rounds up to 1
+    float output = read(brighter);
+    if (mix > 0.f) { output += mix * (read(darker) - output); }
+    return output;
+  }
+
+  int getLevel () const {return brighterLevel;}
+
+protected:
+  // x = log2(f H0 / nyquist): level ceil(x) is the brightest one that can't alias
+  void chooseLevels () {
+    int last = wavetable->getNumLevels() - 1;
+    float f = fabsf(frequency);
+    float x = f > 0.f ? log2f(f * wavetable->getHarmonics(0) / (0.5f * sampleRate)) : -1.f;
+    int level = static_cast<int>(ceilf(x));
+    level = level < 0 ? 0 : (level > last ? last : level);
+    float position = x - (level - 1); // <- 0..1 through this level's octave
+    mix = (position - (1.f - fadeWidth)) / fadeWidth;
+    mix = mix < 0.f ? 0.f : (mix > 1.f ? 1.f : mix);
+    brighterLevel = level;
+    brighter = wavetable->getLevel(level);
+    darker = wavetable->getLevel(level < last ? level + 1 : last);
+  }
+
+  float read (const float* table) const {
+    float index = phase * wavetable->getTableSize();
+    int i = static_cast<int>(index);
+    float frac = index - i;
+    return table[i] + frac * (table[i + 1] - table[i]);
+  }
+
+  const float fadeWidth = 0.25f; // <- octaves
+  std::shared_ptr<const Wavetable> wavetable;
+  const float* brighter = nullptr;
+  const float* darker = nullptr;
+  int brighterLevel = 0;
+  float mix = 0.f;
+};
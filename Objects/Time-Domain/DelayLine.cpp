@@ -1,24 +1,68 @@
-// Joel A. Jaffe 2024-03-14 
+// Joel A. Jaffe 2024-03-14
 /*
 Implementation of a lightweight circular buffer using a fixed-size array.
 Maximum delay is 96000 samples.
+
+Storage picks the sample format in the buffer (DelayStorage.cpp).
+DelayLine is the float version; BasicDelayLine<Int16Storage> or
+<HalfStorage> halves the memory with the same interface. pushBlock and
+popBlock convert whole blocks with the vectorized kernels.
 */
 
-class DelayLine {
+#pragma once
+
+#include "DelayStorage.cpp"
+
+template<typename Storage = FloatStorage>
+class BasicDelayLine {
 public:
+  using Sample = typename Storage::Sample;
+
   void pushSample (float sample) {
-    buffer[writeIndex] = sample;
+    buffer[writeIndex] = Storage::encode(sample);
     writeIndex = (writeIndex + 1) % bufferSize;
   }
 
   float popSample (int delayTimeInSamples) {
     readIndex = (writeIndex - delayTimeInSamples + bufferSize) % bufferSize;
-    return buffer[readIndex];
+    return Storage::decode(buffer[readIndex]);
+  }
+
+  // fractional delay, linear interpolation between neighbouring samples
+  float popSampleInterpolated (float delayTimeInSamples) {
+    int whole = static_cast<int>(delayTimeInSamples);
+    float frac = delayTimeInSamples - whole;
+    float a = popSample(whole);
+    float b = popSample(whole + 1);
+    return a + frac * (b - a);
   }
 
+  void pushBlock (const float* input, int numSamples) {
+    int first = numSamples < bufferSize - writeIndex ? numSamples : bufferSize - writeIndex;
+    Storage::encodeBlock(input, buffer + writeIndex, first);
+    Storage::encodeBlock(input + first, buffer, numSamples - first); // <- wrapped part
+    writeIndex = (writeIndex + numSamples) % bufferSize;
+  }
+
+  // after pushBlock, same as calling pushSample then popSample(delay) per
+  // sample; numSamples + delay must stay within the buffer
+  void popBlock (int delayTimeInSamples, float* output, int numSamples) {
+    int start = (writeIndex - numSamples + 1 - delayTimeInSamples + 2 * bufferSize) % bufferSize;
+    int first = numSamples < bufferSize - start ? numSamples : bufferSize - start;
+    Storage::decodeBlock(buffer + start, output, first);
+    Storage::decodeBlock(buffer, output + first, numSamples - first);
+  }
+
+  // raw access for multi-tap readers that compute their own indices
+  const Sample* getBuffer () const {return buffer;}
+  int getWriteIndex () const {return writeIndex;}
+  static int getBufferSize () {return bufferSize;}
+
 private:
   static const int bufferSize = 96000;
-  float buffer[bufferSize];
-  int readIndex;
-  int writeIndex;
-};
\ No newline at end of file
+  Sample buffer[bufferSize] = {};
+  int readIndex = 0;
+  int writeIndex = 0;
+};
+
+using DelayLine = BasicDelayLine<FloatStorage>;
@@ -0,0 +1,69 @@
+/*
+Sample storage policies for delay buffers: float, int16 or float16.
+
+A delay line keeps Storage::Sample in its buffer and converts with
+encode/decode per sample, or encodeBlock/decodeBlock for whole blocks.
+The block conversions for the 16-bit formats run as DSPCore kernels,
+vectorized for the CPU. The 16-bit formats halve the buffer, so twice
+as much delay fits in cache when dozens of long delays run at once.
+
+- FloatStorage: exact, 4 bytes per sample. The default.
+- Int16Storage: 16-bit fixed point, about 96 dB of dynamic range.
+  Rounds to nearest and clamps to [-1, 1), so keep feedback paths below
+  full scale.
+- HalfStorage: float16, noise about 70 dB below the signal at any
+  level. It doesn't clip below 65504, so it suits feedback paths and
+  unnormalized signals.
+
+The 16-bit formats need DSPCore to be linked.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "../Kernels/DSPKernels.cpp"
+#include "../Utility/HalfFloat.cpp"
+
+struct FloatStorage {
+  using Sample = float;
+  static Sample encode (float x) {return x;}
+  static float decode (Sample s) {return s;}
+  static void encodeBlock (const float* input, Sample* output, int numSamples) {
+    memcpy(output, input, numSamples * sizeof(float));
+  }
+  static void decodeBlock (const Sample* input, float* output, int numSamples) {
+    memcpy(output, input, numSamples * sizeof(float));
+  }
+};
+
+// same scaling and rounding as the pcm16 kernels, so per-sample and block writes agree
+struct Int16Storage {
+  using Sample = int16_t;
+  static Sample encode (float x) {
+    x *= 32768.f; // <- one scale both ways, so decode(encode(x)) keeps the gain
+    x = x < -32768.f ? -32768.f : (x > 32767.f ? 32767.f : x);
+    x = (x + 12582912.f) - 12582912.f; // <- round to nearest, unbiased
+    return static_cast<int16_t>(static_cast<int>(x));
+  }
+  static float decode (Sample s) {return s * (1.f / 32768.f);}
+  static void encodeBlock (const float* input, Sample* output, int numSamples) {
+    dspKernels().floatToPcm16(input, output, numSamples);
+  }
+  static void decodeBlock (const Sample* input, float* output, int numSamples) {
+    dspKernels().pcm16ToFloat(input, output, numSamples);
+  }
+};
+
+struct HalfStorage {
+  using Sample = uint16_t;
+  static Sample encode (float x) {return floatToHalf(x);}
+  static float decode (Sample s) {return halfToFloat(s);}
+  static void encodeBlock (const float* input, Sample* output, int numSamples) {
+    dspKernels().floatToHalf(input, output, numSamples);
+  }
+  static void decodeBlock (const Sample* input, float* output, int numSamples) {
+    dspKernels().halfToFloat(input, output, numSamples);
+  }
+};
@@ -0,0 +1,241 @@
+/*
+Implementation of an N-grain granular engine, generalizing PitchShift's
+two overlapping windowed taps to a pool of up to maxGrains grains.
+
+The input is written to one circular buffer and every grain reads from
+it: a start index, a playback rate and a window position. Grain state is
+kept as arrays (structure of arrays) in a fixed pool allocated in the
+constructor. The sum across grains is one flat loop with no branches, so
+the compiler can vectorize it and CPU cost grows linearly with the number
+of active grains. Once the pool is full, new grains are skipped and
+counted instead of allocating.
+
+Grains are scheduled once per block at density grains per second. Each
+gets an onset offset inside the block, and its window position starts
+negative until that offset is reached. Windows come from lookup tables
+(Hann, triangle, Tukey, Gaussian) with linear interpolation, instead of
+cosf per sample.
+
+Textures: position sets how far behind the input grains start, and spray
+randomizes it. Time-stretching: setFreeze(true) stops writing input, and
+the playhead then scans the captured buffer at scanRate. 0.25 is four
+times slower at the original pitch.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../Utility/FastMath.cpp"
+
+class Granulator {
+public:
+  static const int maxGrains = 256;
+  static const int tableSize = 512;
+  enum WindowShape {HANN, TRIANGLE, TUKEY, GAUSSIAN, numShapes};
+
+  Granulator (int samprate, float maxDelayMs = 4000.f) : sampleRate(samprate) {
+    int needed = static_cast<int>(maxDelayMs * sampleRate / 1000.f) + 4;
+    int size = 1;
+    while (size < needed) { size *= 2; }
+    buffer.assign(size, 0.f);
+    mask = size - 1;
+    windows.assign(numShapes * (tableSize + 1), 0.f);
+    for (int shape = 0; shape < numShapes; shape++) { fillWindow(shape); }
+    setGrainSize(grainSizeMs);
+    setDensity(density);
+  }
+
+  void setGrainSize (float ms) {
+    grainSizeMs = ms < 1.f ? 1.f : ms;
+    grainLength = grainSizeMs * sampleRate / 1000.f;
+    updateNormalization();
+  }
+
+  void setDensity (float grainsPerSecond) {
+    density = grainsPerSecond < 0.1f ? 0.1f : grainsPerSecond;
+    interval = sampleRate / density;
+    updateNormalization();
+  }
+
+  void setPitchRatio (float ratio) {pitchRatio = ratio > 0.f ? ratio : 1.f;}
+  void setPitchSpread (float semitones) {pitchSpread = semitones;} // <- random +/- per grain
+  void setPosition (float ms) {positionMs = ms < 0.f ? 0.f : ms;} // <- delay behind the input
+  void setSpray (float ms) {sprayMs = ms < 0.f ? 0.f : ms;} // <- random extra delay per grain
+  void setWindow (WindowShape shape) {windowShape = shape;} // <- applies to new grains
+  void setScanRate (float rate) {scanRate = rate;} // <- playhead speed while frozen
+
+  void setFreeze (bool freeze) {
+    if (freeze && !frozen) { playhead = static_cast<double>(written) - positionMs * sampleRate / 1000.f; }
+    frozen = freeze;
+  }
+
+  void processBlock (const float* input, float* output, int numSamples) {
+    long long blockStart = written;
+    if (!frozen) {
+      for (int i = 0; i < numSamples; i++) { buffer[(written + i) & mask] = input[i]; }
+      written += numSamples;
+    }
+    schedule(blockStart, numSamples);
+
+    // branchless sum across grains, one pass per sample
+    const float* table = windows.data();
+    for (int i = 0; i < numSamples; i++) {
+      float sum = 0.f;
+      for (int g = 0; g < numActive; g++) {
+        float w = windowPos[g];
+        float inside = (w >= 0.f) & (w < static_cast<float>(tableSize)) ? 1.f : 0.f; // <- not started or finished
+        float wc = w < 0.f ? 0.f : (w > tableSize - 0.001f ? tableSize - 0.001f : w);
+        int wi = static_cast<int>(wc);
+        float wf = wc - wi;
+        const float* shape = table + windowOffset[g] + wi;
+        float win = (shape[0] + wf * (shape[1] - shape[0])) * inside;
+        float r = wc * readScale[g]; // <- samples into the grain
+        int ri = static_cast<int>(r);
+        float rf = r - ri;
+        float a = buffer[(start[g] + ri) & mask];
+        float b = buffer[(start[g] + ri + 1) & mask];
+        sum += win * (a + rf * (b - a));
+        windowPos[g] = w + windowStep[g];
+      }
+      output[i] = sum * outputGain;
+    }
+    retire();
+  }
+
+  // delay at the centre of a grain, from position (not spray); 0 while frozen
+  int getLatency () const {
+    if (frozen) { return 0; }
+    float delay = positionMs * sampleRate / 1000.f;
+    float lead = pitchRatio > 1.f ? grainLength * (pitchRatio - 1.f) + 2.f : 2.f;
+    if (delay < lead) { delay = lead; }
+    return static_cast<int>(delay + grainLength * (1.f - pitchRatio) / 2.f + 0.5f);
+  }
+
+  int getActiveGrains () const {return numActive;}
+  long long getSkippedGrains () const {return skippedGrains;}
+
+private:
+  void fillWindow (int shape) {
+    float* table = windows.data() + shape * (tableSize + 1);
+    for (int i = 0; i <= tableSize; i++) {
+      float x = static_cast<float>(i) / tableSize; // <- 0..1 across the grain
+      float value;
+      if (shape == HANN) {
+        value = 0.5f - 0.5f * cosf(2.f * static_cast<float>(M_PI) * x);
+      } else if (shape == TRIANGLE) {
+        value = 1.f - fabsf(2.f * x - 1.f);
+      } else if (shape == TUKEY) { // <- cosine tapers on the outer quarters
+        float edge = x < 0.5f ? x : 1.f - x;
+        value = edge >= 0.25f ? 1.f : 0.5f - 0.5f * cosf(static_cast<float>(M_PI) * edge / 0.25f);
+      } else { // gaussian, shifted so the ends are 0
+        float d = (x - 0.5f) / 0.15f;
+        float floor = expf(-0.5f * (0.5f / 0.15f) * (0.5f / 0.15f));
+        value = (expf(-0.5f * d * d) - floor) / (1.f - floor);
+      }
+      table[i] = value;
+    }
+  }
+
+  // overlapping grains add roughly like uncorrelated signals
+  void updateNormalization () {
+    float overlap = density * grainSizeMs / 1000.f;
+    outputGain = overlap > 1.f ? 1.f / sqrtf(overlap) : 1.f;
+  }
+
+  void schedule (long long blockStart, int numSamples) {
+    while (untilNext < numSamples) {
+      spawn(blockStart, static_cast<int>(untilNext));
+      untilNext += interval;
+    }
+    untilNext -= numSamples;
+    if (frozen) { // <- loop over what was captured, leaving room for a grain at the end
+      double size = static_cast<double>(buffer.size());
+      double captured = written < size ? static_cast<double>(written) : size;
+      double begin = written - captured;
+      double length = captured - grainLength * pitchRatio;
+      playhead += scanRate * numSamples;
+      if (length > 1.0) { playhead = begin + (playhead - begin) - floor((playhead - begin) / length) * length; }
+    }
+  }
+
+  void spawn (long long blockStart, int offset) {
+    if (numActive >= maxGrains) { skippedGrains++; return; }
+    float rate = pitchRatio;
+    if (pitchSpread > 0.f) { rate *= fastExp2(pitchSpread * (2.f * nextRandom() - 1.f) / 12.f); }
+    float span = grainLength * rate; // <- input samples one grain reads
+    float spray = sprayMs * nextRandom() * sampleRate / 1000.f;
+    long long startIndex;
+    if (frozen) {
+      startIndex = static_cast<long long>(playhead + scanRate * offset - spray);
+    } else {
+      float delay = positionMs * sampleRate / 1000.f + spray;
+      float lead = rate > 1.f ? grainLength * (rate - 1.f) + 2.f : 2.f; // <- never overtake the write head
+      float maxDelay = static_cast<float>(buffer.size()) - span - 2.f;
+      delay = delay < lead ? lead : (delay > maxDelay ? maxDelay : delay);
+      startIndex = blockStart + offset - static_cast<long long>(delay);
+    }
+    int g = numActive++;
+    start[g] = static_cast<int>(startIndex & mask);
+    windowStep[g] = tableSize / grainLength;
+    windowPos[g] = -offset * windowStep[g];
+    readScale[g] = span / tableSize;
+    windowOffset[g] = windowShape * (tableSize + 1);
+  }
+
+  // drop finished grains, keeping the active ones packed at the front
+  void retire () {
+    for (int g = 0; g < numActive;) {
+      if (windowPos[g] >= tableSize) {
+        int last = --numActive;
+        start[g] = start[last];
+        windowPos[g] = windowPos[last];
+        windowStep[g] = windowStep[last];
+        readScale[g] = readScale[last];
+        windowOffset[g] = windowOffset[last];
+      } else {
+        g++;
+      }
+    }
+  }
+
+  float nextRandom () { // <- xorshift, 0..1, no locks or allocation
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return (rngState >> 8) * (1.f / 16777216.f);
+  }
+
+  int sampleRate;
+  std::vector<float> buffer;
+  std::vector<float> windows; // <- numShapes tables of tableSize + 1
+  int mask;
+  long long written = 0;
+
+  float grainSizeMs = 80.f;
+  float grainLength = 0.f;
+  float density = 25.f;
+  float interval = 0.f;
+  float untilNext = 0.f;
+  float pitchRatio = 1.f;
+  float pitchSpread = 0.f;
+  float positionMs = 20.f;
+  float sprayMs = 0.f;
+  float scanRate = 1.f;
+  float outputGain = 1.f;
+  bool frozen = false;
+  double playhead = 0.0;
+  WindowShape windowShape = HANN;
+  uint32_t rngState = 0x9E3779B9u;
+  long long skippedGrains = 0;
+
+  // structure of arrays, one slot per grain
+  int numActive = 0;
+  int start[maxGrains] = {};
+  float windowPos[maxGrains] = {};
+  float windowStep[maxGrains] = {};
+  float readScale[maxGrains] = {};
+  int windowOffset[maxGrains] = {};
+};
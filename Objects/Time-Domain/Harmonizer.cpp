@@ -0,0 +1,133 @@
+/*
+Implementation of a multi-voice harmonizer built on the PitchShift design.
+
+Every voice is a PitchShift-style pair of read heads sweeping a window of
+the input with complementary cosine gains, but all voices read from one
+shared circular buffer that is written once per sample. Memory is one
+buffer plus a few floats per voice, instead of a 96000-sample buffer per
+voice.
+
+Voice state is kept as arrays (structure of arrays). The phase, tap and
+window-gain math runs as one loop across voices, and the cosine is a
+polynomial instead of cosf, so the compiler can vectorize it. Reads use
+linear interpolation between samples.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+class Harmonizer {
+public:
+  static const int maxVoices = 8;
+
+  Harmonizer (int samprate, float maxWindowMs = 100.f) : sampleRate(samprate) {
+    int needed = static_cast<int>(maxWindowMs * sampleRate / 1000.f) + 4;
+    int size = 1;
+    while (size < needed) { size *= 2; }
+    buffer.assign(size, 0.f);
+    mask = size - 1;
+    maxWindowSize = maxWindowMs;
+    for (int v = 0; v < maxVoices; v++) {
+      phase[v] = 0.f;
+      increment[v] = 0.f;
+      upShift[v] = 0.f;
+      gain[v] = 0.f;
+      ratio[v] = 1.f;
+    }
+  }
+
+  // voice 0..maxVoices-1; voices above numVoices are silent
+  void setVoice (int voice, float pitchRatio, float voiceGain) {
+    if (voice < 0 || voice >= maxVoices) { return; }
+    ratio[voice] = pitchRatio;
+    gain[voice] = voiceGain;
+    if (voice >= numVoices) { numVoices = voice + 1; }
+    updateIncrement(voice);
+  }
+
+  void setNumVoices (int voices) {numVoices = voices < maxVoices ? voices : maxVoices;}
+
+  void setWindowSize (float ms) { // <- same units as PitchShift
+    windowSize = ms < maxWindowSize ? ms : maxWindowSize;
+    for (int v = 0; v < numVoices; v++) { updateIncrement(v); }
+  }
+
+  float processSample (float input) {
+    buffer[writeIndex] = input; // written once for every voice
+    float windowSamples = windowSize * (sampleRate / 1000.f);
+
+    // per-voice phase, taps and window gains: one vectorizable pass
+    for (int v = 0; v < numVoices; v++) {
+      float p = phase[v] + increment[v];
+      p -= static_cast<float>(static_cast<int>(p)); // <- wrap to [0, 1)
+      phase[v] = p;
+      float tap = p + upShift[v] * (1.f - 2.f * p); // <- 1 - p when shifting up
+      float tap2 = tap + 0.5f;
+      tap2 -= static_cast<float>(static_cast<int>(tap2));
+      delayOne[v] = tap * windowSamples;
+      delayTwo[v] = tap2 * windowSamples;
+      windowOne[v] = gain[v] * cosPi(tap - 0.5f);
+      windowTwo[v] = gain[v] * cosPi(tap2 - 0.5f);
+    }
+
+    float output = 0.f;
+    for (int v = 0; v < numVoices; v++) {
+      output += read(delayOne[v]) * windowOne[v] + read(delayTwo[v]) * windowTwo[v];
+    }
+    writeIndex = (writeIndex + 1) & mask;
+    return output;
+  }
+
+  void processBlock (const float* input, float* output, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      output[i] = processSample(input[i]);
+    }
+  }
+
+  // half the window, same as PitchShift
+  int getLatency () const {return static_cast<int>(windowSize * (sampleRate / 1000.f) * 0.5f + 0.5f);}
+  int getTailLength () const {return static_cast<int>(ceilf(windowSize * (sampleRate / 1000.f))) + 2;} // <- taps interpolate
+
+protected:
+  void updateIncrement (int v) {
+    float frequency = fabsf(1000.f * ((1.f - ratio[v]) / windowSize));
+    increment[v] = frequency / static_cast<float>(sampleRate);
+    upShift[v] = ratio[v] > 1.f ? 1.f : 0.f;
+    if (ratio[v] == 1.f) { phase[v] = 0.f; } // <- no shift, like PitchShift
+  }
+
+  // cos(pi * x) for x in [-0.5, 0.5], error < 3e-5
+  static float cosPi (float x) {
+    float x2 = x * x;
+    return 1.f + x2 * (-4.934802f + x2 * (4.058712f + x2 * (-1.335263f + x2 * 0.235330f)));
+  }
+
+  float read (float delay) const {
+    int whole = static_cast<int>(delay);
+    float frac = delay - whole;
+    float a = buffer[(writeIndex - whole) & mask];
+    float b = buffer[(writeIndex - whole - 1) & mask];
+    return a + frac * (b - a);
+  }
+
+  int sampleRate;
+  float windowSize = 22.f;
+  float maxWindowSize;
+  std::vector<float> buffer;
+  int mask;
+  int writeIndex = 0;
+  int numVoices = 0;
+
+  // structure of arrays, one slot per voice
+  float phase[maxVoices];
+  float increment[maxVoices];
+  float upShift[maxVoices];
+  float gain[maxVoices];
+  float ratio[maxVoices];
+  float delayOne[maxVoices];
+  float delayTwo[maxVoices];
+  float windowOne[maxVoices];
+  float windowTwo[maxVoices];
+};
@@ -0,0 +1,87 @@
+/*
+Implementation of latency compensation for parallel signal paths.
+
+Processors report their delay in samples through getLatency() (0 for
+minimum-phase filters, half the window for PitchShift, the lookahead for
+Limiter). When paths with different latencies are summed or sent to
+separate outputs, every path is delayed up to the slowest one, so the
+outputs line up sample for sample. getLatency() on the compensator is
+that total, which is what the host should be told.
+
+CompensationDelay is a plain integer delay with a power-of-two ring
+allocated in the constructor. Changing a path's latency moves the read
+tap at once; it's meant for latencies that change on a setting, not per
+block.
+*/
+
+#pragma once
+
+#include <vector>
+
+class CompensationDelay {
+public:
+  CompensationDelay (int maxDelaySamples = 0) {
+    int size = 1;
+    while (size < maxDelaySamples + 1) { size *= 2; }
+    buffer.assign(size, 0.f);
+    mask = size - 1;
+  }
+
+  void setDelay (int samples) {delay = samples < 0 ? 0 : (samples > mask ? mask : samples);}
+  int getDelay () const {return delay;}
+
+  float processSample (float input) {
+    if (delay == 0) { return input; }
+    buffer[writeIndex] = input;
+    float output = buffer[(writeIndex - delay) & mask];
+    writeIndex = (writeIndex + 1) & mask;
+    return output;
+  }
+
+  void processBlock (const float* input, float* output, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      output[i] = processSample(input[i]);
+    }
+  }
+
+  void reset () {
+    for (float& sample : buffer) { sample = 0.f; }
+  }
+
+private:
+  std::vector<float> buffer;
+  int mask;
+  int writeIndex = 0;
+  int delay = 0;
+};
+
+// one CompensationDelay per parallel path, each set to (slowest - own latency)
+class LatencyCompensator {
+public:
+  LatencyCompensator (int numPaths, int maxLatencySamples) :
+  latencies(numPaths, 0), delays(numPaths, CompensationDelay(maxLatencySamples)) {}
+
+  void setPathLatency (int path, int samples) {
+    if (path < 0 || path >= static_cast<int>(latencies.size())) { return; }
+    latencies[path] = samples;
+    totalLatency = 0;
+    for (int latency : latencies) { totalLatency = latency > totalLatency ? latency : totalLatency; }
+    for (int p = 0; p < static_cast<int>(delays.size()); p++) { delays[p].setDelay(totalLatency - latencies[p]); }
+  }
+
+  // call once per sample per path, with that path's output
+  float processSample (int path, float input) {return delays[path].processSample(input);}
+
+  void processBlock (int path, const float* input, float* output, int numSamples) {
+    delays[path].processBlock(input, output, numSamples);
+  }
+
+  int getLatency () const {return totalLatency;}
+  int getCompensation (int path) const {return delays[path].getDelay();}
+  int getTailLength () const {return totalLatency;} // <- the longest delay, flushed
+
+private:
+  std::vector<int> latencies;
+  std::vector<CompensationDelay> delays;
+  int totalLatency = 0;
+};
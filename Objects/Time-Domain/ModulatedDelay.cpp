@@ -0,0 +1,163 @@
+/*
+Implementation of LFO-modulated multi-tap delay effects on DelayLine.
+
+MultiTapDelay keeps its taps as arrays (structure of arrays): base delay,
+modulation depth, LFO phase and rate, gain, and a one-pole lowpass per
+tap. Each sample runs three loops across taps. The first computes
+fractional delays and buffer indices, the second gathers the two
+neighbouring samples for each tap, and the third interpolates, filters
+and sums. None of the loops branch, so the index and interpolation loops
+vectorize at the baseline SSE2 the apps are built with. The gather stays
+scalar loads: a hardware gather needs -mavx2, and this header is compiled
+into each app rather than into the CPUID-dispatched DSPCore kernels. At
+eight taps at most, the loads are a small share of the cost.
+
+Chorus, Flanger and Echo are MultiTapDelays with preset taps. Run one per
+channel to stack them across a rig. LoadTest -c fx measures them.
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include "DelayLine.cpp"
+
+class MultiTapDelay {
+public:
+  static const int maxTaps = 8;
+
+  MultiTapDelay (int samprate) : sampleRate(samprate) {
+    for (int t = 0; t < maxTaps; t++) {
+      baseDelay[t] = 1.f;
+      depth[t] = 0.f;
+      lfoPhase[t] = 0.f;
+      lfoIncrement[t] = 0.f;
+      gain[t] = 0.f;
+      lowpassCoef[t] = 1.f;
+      lowpassState[t] = 0.f;
+    }
+  }
+
+  // times in ms, rate in Hz, cutoff in Hz (0 = unfiltered)
+  void setTap (int tap, float delayMs, float depthMs, float rateHz,
+               float tapGain, float cutoffHz = 0.f, float startPhase = 0.f) {
+    if (tap < 0 || tap >= maxTaps) { return; }
+    float maxMs = (DelayLine::getBufferSize() - 2) * 1000.f / sampleRate;
+    depthMs = fminf(depthMs, delayMs);
+    baseDelay[tap] = fmaxf(1.f, fminf(delayMs, maxMs - depthMs) * sampleRate / 1000.f);
+    depth[tap] = depthMs * sampleRate / 1000.f;
+    lfoIncrement[tap] = rateHz / sampleRate;
+    lfoPhase[tap] = startPhase;
+    gain[tap] = tapGain;
+    lowpassCoef[tap] = cutoffHz > 0.f ? 1.f - expf(-2.f * M_PI * cutoffHz / sampleRate) : 1.f;
+    if (tap >= numTaps) { numTaps = tap + 1; }
+  }
+
+  void setFeedback (float amount) {feedback = amount;}
+  void setMix (float dry, float wet) {dryGain = dry; wetGain = wet;}
+
+  float processSample (float input) {
+    const float* buffer = line.getBuffer();
+    const int size = DelayLine::getBufferSize();
+    const int write = line.getWriteIndex();
+
+    // modulated fractional delays and read indices
+    for (int t = 0; t < numTaps; t++) {
+      float p = lfoPhase[t] + lfoIncrement[t];
+      p -= static_cast<float>(static_cast<int>(p));
+      lfoPhase[t] = p;
+      float delay = baseDelay[t] + depth[t] * 0.5f * (1.f + lfoShape(p));
+      int whole = static_cast<int>(delay);
+      frac[t] = delay - whole;
+      int index = write - whole;
+      indexA[t] = index + (index < 0 ? size : 0);
+      index = indexA[t] - 1;
+      indexB[t] = index + (index < 0 ? size : 0);
+    }
+
+    // gather
+    for (int t = 0; t < numTaps; t++) {
+      sampleA[t] = buffer[indexA[t]];
+      sampleB[t] = buffer[indexB[t]];
+    }
+
+    // interpolate, filter per tap, sum
+    float wet = 0.f;
+    for (int t = 0; t < numTaps; t++) {
+      float x = sampleA[t] + frac[t] * (sampleB[t] - sampleA[t]);
+      lowpassState[t] += lowpassCoef[t] * (x - lowpassState[t]);
+      wet += lowpassState[t] * gain[t];
+    }
+
+    line.pushSample(input + wet * feedback);
+    return input * dryGain + wet * wetGain;
+  }
+
+  void processBlock (const float* input, float* output, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      output[i] = processSample(input[i]);
+    }
+  }
+
+protected:
+  // cos(2 pi p) for p in [0, 1), max error ~1e-4: plenty for an LFO
+  static float lfoShape (float p) {
+    float x = 2.f * p - 1.f; // cos(2 pi p) = -cos(pi x)
+    float x2 = x * x;
+    float c = 1.f + x2 * (-4.934802f + x2 * (4.058712f + x2 * (-1.335263f +
+      x2 * (0.235331f + x2 * (-0.025807f + x2 * 0.001907f)))));
+    return -c;
+  }
+
+  int sampleRate;
+  int numTaps = 0;
+  float feedback = 0.f;
+  float dryGain = 1.f;
+  float wetGain = 1.f;
+  DelayLine line;
+
+  // structure of arrays, one slot per tap
+  float baseDelay[maxTaps];
+  float depth[maxTaps];
+  float lfoPhase[maxTaps];
+  float lfoIncrement[maxTaps];
+  float gain[maxTaps];
+  float lowpassCoef[maxTaps];
+  float lowpassState[maxTaps];
+  float frac[maxTaps];
+  int indexA[maxTaps];
+  int indexB[maxTaps];
+  float sampleA[maxTaps];
+  float sampleB[maxTaps];
+};
+
+// three detuned voices around 20 ms, no feedback
+class Chorus : public MultiTapDelay {
+public:
+  Chorus (int samprate) : MultiTapDelay(samprate) {
+    setTap(0, 15.f, 4.f, 0.31f, 0.33f, 0.f, 0.f);
+    setTap(1, 20.f, 5.f, 0.47f, 0.33f, 0.f, 0.33f);
+    setTap(2, 25.f, 4.f, 0.61f, 0.33f, 0.f, 0.67f);
+    setMix(0.7f, 0.7f);
+  }
+};
+
+// one short sweeping tap with feedback
+class Flanger : public MultiTapDelay {
+public:
+  Flanger (int samprate) : MultiTapDelay(samprate) {
+    setTap(0, 3.f, 2.5f, 0.25f, 1.f);
+    setFeedback(0.6f);
+    setMix(0.7f, 0.7f);
+  }
+};
+
+// feedback echo with a darkening repeat and a little tape wobble
+class Echo : public MultiTapDelay {
+public:
+  Echo (int samprate, float timeMs = 375.f, float repeats = 0.45f) : MultiTapDelay(samprate) {
+    setTap(0, timeMs, 0.3f, 0.8f, 1.f, 4000.f);
+    setFeedback(repeats);
+    setMix(1.f, 0.5f);
+  }
+};
@@ -2,20 +2,67 @@
 /*
 Implementation of a time-domain pitch shifter
 
+Storage picks the delay buffer's sample format (DelayStorage.cpp):
+PitchShift is the float version, BasicPitchShift<Int16Storage> or
+<HalfStorage> halves its memory. processBlock() encodes each block into
+the buffer with the vectorized kernels before reading the taps.
+
 TO-DO:
 -make windowSize adjustable 
 */
 
+#pragma once
+
 #include <cmath>
 using namespace std;
 
-class PitchShift {
+#include "DelayStorage.cpp"
+
+template<typename Storage = FloatStorage>
+class BasicPitchShift {
 public:
-  PitchShift (int samprate) : sampleRate(samprate) {}
+  BasicPitchShift (int samprate) : sampleRate(samprate) {}
 
   void setPitchRatio (float ratio) {pitchRatio = ratio;}
 
+  // the taps sweep 0..windowSize, centred on half of it (exact when not shifting)
+  int getLatency () const {return static_cast<int>(round(windowSize * (sampleRate / 1000.f) / 2.f));}
+
+  // silent input samples until the taps only read silence
+  int getTailLength () const {return static_cast<int>(round(windowSize * (sampleRate / 1000.f))) + 1;}
+
   float processSample(float input) {
+    this->writeSample(input); // write sample to delay buffer
+    return readTaps();
+  }
+
+  // same output as processSample per sample
+  void processBlock (const float* input, float* output, int numSamples) {
+    for (int done = 0; done < numSamples; done += maxChunk) { // <- chunks stay clear of the taps
+      int n = numSamples - done < maxChunk ? numSamples - done : maxChunk;
+      int start = writeIndex;
+      int first = n < bufferSize - start ? n : bufferSize - start;
+      Storage::encodeBlock(input + done, buffer + start, first);
+      Storage::encodeBlock(input + done + first, buffer, n - first);
+      for (int i = 0; i < n; i++) {
+        writeIndex = (start + i + 1) % bufferSize; // <- as if written one at a time
+        output[done + i] = readTaps();
+      }
+    }
+  }
+
+  // circular write; index 0 is still the oldest sample, bufferSize - 1 the newest
+  void writeSample (float sample) {
+    buffer[writeIndex] = Storage::encode(sample);
+    writeIndex = (writeIndex + 1) % bufferSize;
+  }
+
+  float readSample (int index) {
+    return Storage::decode(buffer[(writeIndex + index) % bufferSize]);
+  }
+
+private:
+  float readTaps () {
     float frequency = fabs(1000.f * ((1.f - pitchRatio) / windowSize));
     float phaseIncrement = frequency / static_cast<float>(sampleRate);
 
@@ -27,8 +74,6 @@ public:
     if (pitchRatio > 1.f) {phaseTap = 1 - phase;} // reverse sawtooth for up shifting  
     else {phaseTap = phase;} // otherwise let it ride 
 
-    this->writeSample(input); // write sample to delay buffer
-
     int readIndex = bufferSize - 1 - static_cast<int>(round( // readpoint 1 
       phaseTap * (windowSize * (sampleRate / 1000.f))));
     int readIndex2 = bufferSize - 1 - static_cast<int>(round( // readpoint 2
@@ -42,23 +87,14 @@ public:
     return output * windowOne + output2 * windowTwo; // windowed output
   }
 
-  void writeSample (float sample) {
-    for (int i = 0; i < bufferSize - 1; i++) {
-      buffer[i] = buffer[i + 1];
-    }
-    buffer[bufferSize - 1] = sample;
-  }
-
-  float readSample (int index) {
-    return buffer[index];
-  }
-
-private:
   static const int bufferSize = 96000;
-  float buffer[bufferSize];
-  int writeIndex;
+  static const int maxChunk = 4096;
+  typename Storage::Sample buffer[bufferSize] = {};
+  int writeIndex = 0;
   int sampleRate;
   float phase = 0.f;
   float pitchRatio = 1.f;
   float windowSize = 22.f; // make adjustable / calculate for optimized ratio? 
-};
\ No newline at end of file
+};
+
+using PitchShift = BasicPitchShift<FloatStorage>;
@@ -0,0 +1,265 @@
+/*
+Implementation of a WSOLA time-stretcher for sample playback: changes
+tempo without changing pitch.
+
+A loaded sample is played back as windowed grains, like PitchShift's
+two taps but with 50% overlap at a fixed hop. Speed sets how far the
+read position moves through the sample per hop; 0.5 plays at half
+tempo and 2 at double, at the original pitch. Before each grain, a
+similarity search looks within +/- tolerance of the nominal position
+for the offset that best continues the previous grain. That offset
+maximizes the normalized cross-correlation with the samples that would
+have followed it. Channels are searched on their sum and share one
+offset, so the stereo image holds.
+
+Because the grains are aligned, the window is a Hann window that sums
+to exactly 1 at 50% overlap. PitchShift's power-complementary taps are
+for uncorrelated taps. At speed 1 the grains are contiguous, so the
+output is the sample itself.
+
+The search is computed once per hop, over every candidate offset at
+once:
+- DIRECT runs the crossCorrelate kernel, window x (2 x tolerance + 1)
+  multiply-adds.
+- SPECTRAL correlates through RealFFT: three transforms of about
+  window + 2 x tolerance points. It wins for long windows and wide
+  tolerances.
+- AUTO picks the cheaper of the two when constructed. The defaults,
+  a 22 ms window and 10 ms tolerance, go spectral.
+
+Storage picks the sample format (DelayStorage.cpp). TimeStretch keeps
+the sample as float; BasicTimeStretch<HalfStorage> halves the memory of
+long backing tracks. The sample plays at its own rate, without
+resampling.
+
+Construct and load() off the audio thread; processBlock() doesn't
+allocate. Needs DSPCore to be linked.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <vector>
+
+#include "DelayStorage.cpp"
+#include "../Frequency-Domain/FFT.cpp"
+#include "../IO/WavFile.cpp"
+#include "../Kernels/DSPKernels.cpp"
+#include "../Utility/AudioBlock.cpp"
+
+template<typename Storage = FloatStorage>
+class BasicTimeStretch {
+public:
+  static const int maxChannels = 8;
+  enum SearchMode {AUTO, DIRECT, SPECTRAL};
+
+  BasicTimeStretch (int samprate, float windowMs = 22.f, float toleranceMs = 10.f) :
+  sampleRate(samprate),
+  hop(atLeast(static_cast<int>(windowMs * samprate / 2000.f + 0.5f), 16)),
+  windowLength(2 * hop),
+  tolerance(atLeast(static_cast<int>(toleranceMs * samprate / 1000.f + 0.5f), 1)),
+  numLags(2 * tolerance + 1),
+  regionLength(windowLength + numLags - 1),
+  fftSize(fastSize(regionLength)),
+  fft(fftSize),
+  window(windowLength), reference(windowLength), region(regionLength), channelScratch(regionLength),
+  correlation(fftSize), referenceSpectrum(fftSize / 2 + 1), regionSpectrum(fftSize / 2 + 1),
+  overlap(maxChannels * hop, 0.f), ready(maxChannels * hop, 0.f) {
+    for (int n = 0; n < windowLength; n++) { // <- periodic Hann: w[n] + w[n + hop] == 1
+      window[n] = 0.5f - 0.5f * cosf(2.f * static_cast<float>(M_PI) * n / windowLength);
+    }
+    setSearchMode(AUTO);
+  }
+
+  // copies and encodes interleaved audio, then rewinds; allocates
+  void load (const float* interleaved, int channels, int frames) {
+    numChannels = channels < 1 ? 0 : (channels < maxChannels ? channels : maxChannels);
+    numFrames = numChannels > 0 && frames > 0 ? frames : 0;
+    source.assign(static_cast<size_t>(numChannels) * numFrames, typename Storage::Sample());
+    std::vector<float> planar(numFrames);
+    for (int ch = 0; ch < numChannels; ch++) {
+      for (int i = 0; i < numFrames; i++) { planar[i] = interleaved[static_cast<size_t>(i) * channels + ch]; }
+      Storage::encodeBlock(planar.data(), source.data() + static_cast<size_t>(ch) * numFrames, numFrames);
+    }
+    setPosition(0.0);
+  }
+
+  // whole WAV file into memory; false if it can't be read
+  bool loadFile (const char* path) {
+    WavReader reader;
+    if (!reader.open(path)) { return false; }
+    std::vector<float> samples(static_cast<size_t>(reader.getFrames()) * reader.getChannels());
+    int frames = reader.read(samples.data(), static_cast<int>(reader.getFrames()));
+    load(samples.data(), reader.getChannels(), frames);
+    return true;
+  }
+
+  void setSpeed (float ratio) {speed = ratio < 0.05f ? 0.05f : (ratio > 8.f ? 8.f : ratio);} // <- tempo, 1 = original
+  void setLoop (bool loop) {looping = loop;}
+
+  void setSearchMode (SearchMode mode) {
+    float directCost = static_cast<float>(windowLength) * numLags;
+    float spectralCost = 24.f * fftSize * log2f(static_cast<float>(fftSize)); // <- three transforms, measured
+    spectral = mode == SPECTRAL || (mode == AUTO && spectralCost < directCost);
+  }
+  bool isSpectral () const {return spectral;}
+
+  // jump to a frame of the sample; not while processBlock() runs
+  void setPosition (double frame) {
+    analysisPosition = frame - hop; // <- the first grain fades in over material before frame
+    lastPosition = 0;
+    started = false;
+    std::fill(overlap.begin(), overlap.end(), 0.f);
+    nextHop(); // <- primes the overlap so output starts at full gain on frame
+    readIndex = hop;
+  }
+
+  double getPosition () const {return analysisPosition;} // <- start of the next grain, in frames
+  int getNumChannels () const {return numChannels;}
+  int getNumFrames () const {return numFrames;}
+  int getLatency () const {return hop;} // <- frames from a position to its full-gain output
+  bool isFinished () const {return !looping && started && lastPosition >= numFrames;}
+
+  // channels past the sample's repeat it (mono to stereo)
+  void processBlock (AudioBlock<float> output) {
+    if (numFrames == 0) { output.clear(); return; }
+    for (int done = 0; done < output.getNumSamples();) {
+      if (readIndex == hop) { nextHop(); }
+      int n = output.getNumSamples() - done < hop - readIndex ? output.getNumSamples() - done : hop - readIndex;
+      for (int ch = 0; ch < output.getNumChannels(); ch++) {
+        memcpy(output.getChannel(ch) + done, ready.data() + (ch % numChannels) * hop + readIndex, n * sizeof(float));
+      }
+      readIndex += n;
+      done += n;
+    }
+  }
+
+private:
+  static int atLeast (int value, int minimum) {return value < minimum ? minimum : value;}
+
+  // smallest even size of factors 2, 3 and 5 (the fast FFT sizes) >= n
+  static int fastSize (int n) {
+    for (int size = n + (n % 2);; size += 2) {
+      int rest = size;
+      for (int factor : {2, 3, 5}) { while (rest % factor == 0) { rest /= factor; } }
+      if (rest == 1) { return size; }
+    }
+  }
+
+  // one grain: pick its position, overlap-add hop samples into ready
+  void nextHop () {
+    long long nominal = llround(analysisPosition);
+    long long position = nominal;
+    if (started && speed == 1.f) { // <- contiguous grains, the sample itself
+      position = lastPosition + hop;
+      analysisPosition = static_cast<double>(position);
+    } else if (started) {
+      position = nominal - tolerance + search(lastPosition + hop, nominal - tolerance);
+    }
+    for (int ch = 0; ch < numChannels; ch++) {
+      float* grain = channelScratch.data();
+      readSource(ch, position, windowLength, grain);
+      float* tail = overlap.data() + ch * hop;
+      float* out = ready.data() + ch * hop;
+      for (int n = 0; n < hop; n++) {
+        out[n] = tail[n] + window[n] * grain[n];
+        tail[n] = window[hop + n] * grain[hop + n];
+      }
+    }
+    lastPosition = position;
+    started = true;
+    analysisPosition += hop * speed;
+    if (looping && lastPosition >= numFrames) { // <- keep positions small; readSource wraps
+      analysisPosition -= numFrames;
+      lastPosition -= numFrames;
+    }
+    readIndex = 0;
+  }
+
+  // offset in [0, numLags) whose window best matches the one at target
+  int search (long long target, long long start) {
+    mixDown(target, windowLength, reference.data());
+    mixDown(start, regionLength, region.data());
+    if (spectral) {
+      float* padded = correlation.data();
+      memcpy(padded, reference.data(), windowLength * sizeof(float));
+      std::fill(padded + windowLength, padded + fftSize, 0.f);
+      fft.forward(padded, referenceSpectrum.data());
+      memcpy(padded, region.data(), regionLength * sizeof(float));
+      std::fill(padded + regionLength, padded + fftSize, 0.f);
+      fft.forward(padded, regionSpectrum.data());
+      for (int b = 0; b < fft.getNumBins(); b++) { regionSpectrum[b] *= std::conj(referenceSpectrum[b]); }
+      fft.inverse(regionSpectrum.data(), padded); // <- no wrap: fftSize >= regionLength
+    } else {
+      dspKernels().crossCorrelate(reference.data(), windowLength, region.data(), correlation.data(), numLags);
+    }
+
+    // normalize by each candidate's energy, kept as a running sum
+    float energy = dspKernels().sumOfSquares(region.data(), windowLength);
+    int best = tolerance; // <- nominal position wins ties and silence
+    float bestScore = -1e30f;
+    for (int k = 0; k < numLags; k++) {
+      float score = correlation[k] / sqrtf((energy > 0.f ? energy : 0.f) + 1e-9f);
+      if (score > bestScore || (k == tolerance && score >= bestScore)) { bestScore = score; best = k; }
+      if (k + 1 < numLags) {
+        energy += region[k + windowLength] * region[k + windowLength] - region[k] * region[k];
+      }
+    }
+    return best;
+  }
+
+  // sum of every channel, decoded
+  void mixDown (long long start, int length, float* output) {
+    readSource(0, start, length, output);
+    for (int ch = 1; ch < numChannels; ch++) {
+      readSource(ch, start, length, channelScratch.data());
+      for (int i = 0; i < length; i++) { output[i] += channelScratch[i]; }
+    }
+  }
+
+  // decodes frames [start, start + length) of a channel; wraps when looping, else zeros outside
+  void readSource (int channel, long long start, int length, float* output) {
+    const typename Storage::Sample* data = source.data() + static_cast<size_t>(channel) * numFrames;
+    for (int done = 0; done < length;) {
+      long long index = start + done;
+      if (looping) { index = ((index % numFrames) + numFrames) % numFrames; }
+      int n;
+      if (index < 0 || index >= numFrames) {
+        n = index < 0 && -index < length - done ? static_cast<int>(-index) : length - done;
+        std::fill(output + done, output + done + n, 0.f);
+      } else {
+        n = numFrames - index < length - done ? static_cast<int>(numFrames - index) : length - done;
+        Storage::decodeBlock(data + index, output + done, n);
+      }
+      done += n;
+    }
+  }
+
+  int sampleRate;
+  int hop;
+  int windowLength;
+  int tolerance; // <- samples either side of the nominal position
+  int numLags;
+  int regionLength;
+  int fftSize;
+  RealFFT fft;
+  std::vector<float> window, reference, region, channelScratch, correlation;
+  std::vector<std::complex<float>> referenceSpectrum, regionSpectrum;
+  std::vector<float> overlap; // <- second half of the last grain, per channel
+  std::vector<float> ready; // <- hop finished samples, per channel
+  std::vector<typename Storage::Sample> source;
+  int numChannels = 0;
+  int numFrames = 0;
+  float speed = 1.f;
+  bool looping = false;
+  bool spectral = false;
+  bool started = false;
+  double analysisPosition = 0.0;
+  long long lastPosition = 0;
+  int readIndex = 0;
+};
+
+using TimeStretch = BasicTimeStretch<FloatStorage>;
@@ -0,0 +1,139 @@
+/*
+Planar audio block views and aligned buffers for whole-block processing.
+
+AudioBlock<T> is a non-owning view of numChannels planar channels of
+numSamples samples each. It wraps the host's buffers without copying:
+
+  float* outs[2] = {io.outBuffer(0), io.outBuffer(1)};
+  AudioBlock<float> out(outs, 2, io.framesPerBuffer());
+
+Views are small and copied by value. getSubBlock() slices samples (for
+splitting a block at events), getChannelRange() slices channels, and an
+AudioBlock<float> converts to an AudioBlock<const float> for inputs.
+Objects take blocks in processBlock(), so block kernels run straight on
+the host's memory instead of one io() step per sample.
+
+AudioBuffer<T> owns the storage that blocks view. Every channel starts
+on a 64-byte boundary and is padded to a multiple of 64 bytes, so full
+AVX-512 vectors can load and store past numSamples without touching
+another channel. Host buffers come as they are, so check isAligned()
+before relying on that. The DSPCore kernels don't need alignment.
+
+The gain, peak and power helpers call DSPCore kernels, so they need
+DSPCore linked; the views and buffers don't.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "../Kernels/DSPKernels.cpp"
+
+template<typename T>
+class AudioBlock {
+public:
+  static const int maxChannels = 32;
+  static const int alignment = 64; // <- bytes, one AVX-512 vector or cache line
+
+  AudioBlock () = default;
+
+  AudioBlock (T* const* channelPointers, int channels, int samples) :
+  numChannels(channels < maxChannels ? channels : maxChannels), numSamples(samples) {
+    for (int ch = 0; ch < numChannels; ch++) { channelData[ch] = channelPointers[ch]; }
+  }
+
+  // AudioBlock<float> -> AudioBlock<const float>
+  template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+  AudioBlock (const AudioBlock<U>& other) : numChannels(other.getNumChannels()), numSamples(other.getNumSamples()) {
+    for (int ch = 0; ch < numChannels; ch++) { channelData[ch] = other.getChannel(ch); }
+  }
+
+  T* getChannel (int channel) const {return channelData[channel];}
+  T* const* getChannelPointers () const {return channelData;} // <- for pointer-array APIs
+  int getNumChannels () const {return numChannels;}
+  int getNumSamples () const {return numSamples;}
+
+  // samples [start, start + length) of every channel
+  AudioBlock getSubBlock (int start, int length) const {
+    AudioBlock sub(*this);
+    for (int ch = 0; ch < numChannels; ch++) { sub.channelData[ch] += start; }
+    sub.numSamples = length;
+    return sub;
+  }
+
+  // channels [first, first + count)
+  AudioBlock getChannelRange (int first, int count) const {
+    return AudioBlock(channelData + first, count, numSamples);
+  }
+
+  bool isAligned () const {
+    for (int ch = 0; ch < numChannels; ch++) {
+      if (reinterpret_cast<uintptr_t>(channelData[ch]) % alignment != 0) { return false; }
+    }
+    return true;
+  }
+
+  void clear () const {
+    for (int ch = 0; ch < numChannels; ch++) { memset(channelData[ch], 0, numSamples * sizeof(T)); }
+  }
+
+  // channel counts can differ; copies the channels both have
+  void copyFrom (const AudioBlock<const T>& source) const {
+    int channels = numChannels < source.getNumChannels() ? numChannels : source.getNumChannels();
+    int samples = numSamples < source.getNumSamples() ? numSamples : source.getNumSamples();
+    for (int ch = 0; ch < channels; ch++) { memmove(channelData[ch], source.getChannel(ch), samples * sizeof(T)); }
+  }
+
+  // in place, every channel: linear ramp from startGain to endGain (float blocks)
+  void applyGainRamp (float startGain, float endGain) const {
+    for (int ch = 0; ch < numChannels; ch++) { dspKernels().gainRamp(channelData[ch], numSamples, startGain, endGain); }
+  }
+
+  float getPeak (int channel) const {return dspKernels().peak(channelData[channel], numSamples);}
+  float getSumOfSquares (int channel) const {return dspKernels().sumOfSquares(channelData[channel], numSamples);}
+
+private:
+  T* channelData[maxChannels] = {};
+  int numChannels = 0;
+  int numSamples = 0;
+};
+
+// owns aligned, padded planar storage; getBlock() views it
+template<typename T>
+class AudioBuffer {
+public:
+  static const int padding = AudioBlock<T>::alignment / sizeof(T); // <- samples
+
+  AudioBuffer (int channels = 0, int maxSamples = 0) {setSize(channels, maxSamples);}
+  AudioBuffer (const AudioBuffer&) = delete; // <- the channel pointers point into storage
+  AudioBuffer& operator= (const AudioBuffer&) = delete;
+
+  // allocates; not for the audio thread
+  void setSize (int channels, int maxSamples) {
+    numChannels = channels < AudioBlock<T>::maxChannels ? channels : AudioBlock<T>::maxChannels;
+    capacity = maxSamples;
+    stride = (maxSamples + padding - 1) / padding * padding;
+    storage.assign(numChannels * stride + padding, T()); // <- slack to reach the first boundary
+    uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+    int offset = static_cast<int>((AudioBlock<T>::alignment - address % AudioBlock<T>::alignment) %
+      AudioBlock<T>::alignment / sizeof(T));
+    for (int ch = 0; ch < numChannels; ch++) { channelData[ch] = storage.data() + offset + ch * stride; }
+  }
+
+  AudioBlock<T> getBlock () const {return AudioBlock<T>(channelData, numChannels, capacity);}
+  AudioBlock<T> getBlock (int numSamples) const {return AudioBlock<T>(channelData, numChannels, numSamples);}
+  T* getChannel (int channel) const {return channelData[channel];}
+  T* const* getChannelPointers () const {return channelData;}
+  int getNumChannels () const {return numChannels;}
+  int getCapacity () const {return capacity;}
+
+private:
+  std::vector<T> storage;
+  T* channelData[AudioBlock<T>::maxChannels] = {};
+  int numChannels = 0;
+  int capacity = 0;
+  int stride = 0;
+};
@@ -0,0 +1,77 @@
+/*
+IEEE 754 half precision (float16) <-> float, in portable integer code.
+
+floatToHalf rounds to nearest even and keeps subnormals, infinities and
+NaN. halfToFloat is exact. Neither needs F16C: both are branch-free
+selects on the bit patterns, so the block versions vectorize on any
+target and give the same bits on every one. float16 has an 11-bit
+significand (about 70 dB of resolution relative to the signal) and
+range up to 65504, so unlike int16 it doesn't clip above 1.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+inline uint16_t floatToHalf (float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  bits &= 0x7FFFFFFFu;
+
+  // subnormal halves: adding 0.5 lines the mantissa up so float rounding does the work
+  uint32_t magicBits = 126u << 23;
+  float magic, shifted;
+  memcpy(&magic, &magicBits, sizeof(magic));
+  memcpy(&shifted, &bits, sizeof(shifted));
+  shifted += magic;
+  uint32_t subnormal;
+  memcpy(&subnormal, &shifted, sizeof(subnormal));
+  subnormal -= magicBits;
+
+  // normal halves: rebias the exponent, round to nearest even on bit 13
+  uint32_t normal = (bits + 0xC8000FFFu + ((bits >> 13) & 1u)) >> 13; // <- 0xC8000000 = (15 - 127) << 23
+
+  // selects as masks: GCC won't if-convert the nested ternaries
+  uint32_t isNaN = 0u - static_cast<uint32_t>(bits > 0x7F800000u);
+  uint32_t isLarge = 0u - static_cast<uint32_t>(bits >= (143u << 23)); // <- overflows to infinity
+  uint32_t isSmall = 0u - static_cast<uint32_t>(bits < (113u << 23));
+  uint32_t special = 0x7C00u | (isNaN & 0x0200u);
+  uint32_t half = (isLarge & special) | (~isLarge & ((isSmall & subnormal) | (~isSmall & normal)));
+  return static_cast<uint16_t>(half | sign);
+}
+
+inline float halfToFloat (uint16_t half) {
+  uint32_t bits = (half & 0x7FFFu) << 13;
+  uint32_t exponent = bits & (0x7C00u << 13);
+  bits += (127u - 15u) << 23;
+
+  // subnormal halves: renormalize through a float subtraction
+  uint32_t magicBits = 113u << 23;
+  float magic, renormed;
+  memcpy(&magic, &magicBits, sizeof(magic));
+  uint32_t raised = bits + (1u << 23);
+  memcpy(&renormed, &raised, sizeof(renormed));
+  renormed -= magic;
+  uint32_t subnormal;
+  memcpy(&subnormal, &renormed, sizeof(subnormal));
+
+  uint32_t special = bits + ((128u - 16u) << 23); // <- infinity and NaN keep max exponent
+  uint32_t isSpecial = 0u - static_cast<uint32_t>(exponent == (0x7C00u << 13));
+  uint32_t isSubnormal = 0u - static_cast<uint32_t>(exponent == 0);
+  bits = (isSpecial & special) | (~isSpecial & ((isSubnormal & subnormal) | (~isSubnormal & bits)));
+  bits |= static_cast<uint32_t>(half & 0x8000u) << 16;
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// block versions
+inline void floatToHalfBlock (const float* input, uint16_t* output, int numSamples) {
+  for (int i = 0; i < numSamples; i++) { output[i] = floatToHalf(input[i]); }
+}
+
+inline void halfToFloatBlock (const uint16_t* input, float* output, int numSamples) {
+  for (int i = 0; i < numSamples; i++) { output[i] = halfToFloat(input[i]); }
+}
@@ -0,0 +1,65 @@
+/*
+Implementation of a lock-free single-producer single-consumer ring buffer.
+Capacity is rounded up to a power of two and allocated once up front, so
+write() and read() are wait-free and safe to call from the audio thread.
+One thread may write and one other thread may read.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template<typename T>
+class SPSCRing {
+public:
+  SPSCRing (int minCapacity) {
+    int capacity = 1;
+    while (capacity < minCapacity) { capacity *= 2; }
+    buffer.resize(capacity);
+    mask = capacity - 1;
+  }
+
+  // producer: copies up to count items, returns how many fit
+  int write (const T* items, int count) {
+    size_t w = writePos.load(std::memory_order_relaxed);
+    size_t r = readPos.load(std::memory_order_acquire);
+    int space = static_cast<int>(buffer.size() - (w - r));
+    if (count > space) { count = space; }
+    for (int i = 0; i < count; i++) {
+      buffer[(w + i) & mask] = items[i];
+    }
+    writePos.store(w + count, std::memory_order_release);
+    return count;
+  }
+
+  // consumer: copies up to count items, returns how many were read
+  int read (T* items, int count) {
+    size_t r = readPos.load(std::memory_order_relaxed);
+    size_t w = writePos.load(std::memory_order_acquire);
+    int ready = static_cast<int>(w - r);
+    if (count > ready) { count = ready; }
+    for (int i = 0; i < count; i++) {
+      items[i] = buffer[(r + i) & mask];
+    }
+    readPos.store(r + count, std::memory_order_release);
+    return count;
+  }
+
+  int availableToRead () const {
+    return static_cast<int>(writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_relaxed));
+  }
+
+  int availableToWrite () const {
+    return static_cast<int>(buffer.size() - (writePos.load(std::memory_order_relaxed) - readPos.load(std::memory_order_acquire)));
+  }
+
+  int getCapacity () const {return static_cast<int>(buffer.size());}
+
+private:
+  std::vector<T> buffer;
+  size_t mask;
+  alignas(64) std::atomic<size_t> writePos{0}; // <- separate cache lines for each side
+  alignas(64) std::atomic<size_t> readPos{0};
+};
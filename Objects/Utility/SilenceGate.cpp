@@ -0,0 +1,79 @@
+/*
+Implementation of block-level silence detection for bypassing idle
+nodes.
+
+A node reports its tail through getTailLength(): how many samples of
+silent input it takes before its output is silent too. One SilenceGate
+per node checks each input block's peak against a threshold. When the
+input has been silent for at least the tail, process() returns false.
+The caller then skips the node and writes zeros:
+
+  gate.setTailLength(chain.getTailLength() + limiter.getTailLength());
+  if (gate.process(input)) { chain.processBlock(input, output); ... }
+  else { output.clear(); }
+
+The node keeps running through the tail, so its delay lines and filter
+states are flushed with silence before the bypass. When input returns
+it carries on from that state with no click. A negative tail (a filter
+that never decays) is never bypassed.
+
+The default threshold of -120 dB counts only digital silence and the
+last bits of a decaying tail. Raise it for inputs with a noise floor.
+Nodes that get no input (synths, players) use process(bool, int) with
+their own idea of silence, e.g. no note held.
+
+The peak check runs the DSPCore peak kernel, so DSPCore must be linked.
+*/
+
+#pragma once
+
+#include "AudioBlock.cpp"
+#include "FastMath.cpp"
+
+class SilenceGate {
+public:
+  SilenceGate (int tailSamples = 0, float thresholddB = -120.f) : tailLength(tailSamples) {
+    setThreshold(thresholddB);
+  }
+
+  void setTailLength (int samples) {tailLength = samples;}
+  void setThreshold (float dB) {threshold = dBtoA(dB);}
+
+  // true if the node has to run this block, false to skip it and output zeros
+  bool process (AudioBlock<const float> input) {
+    bool silent = true;
+    for (int ch = 0; ch < input.getNumChannels() && silent; ch++) { silent = input.getPeak(ch) <= threshold; }
+    return process(silent, input.getNumSamples());
+  }
+
+  bool process (bool inputSilent, int numSamples) {
+    if (!inputSilent || tailLength < 0) {
+      silentSamples = 0;
+      bypassed = false;
+      return true;
+    }
+    bypassed = silentSamples >= tailLength; // <- the tail has run out on silence
+    if (bypassed) {
+      bypassedBlocks++;
+      return false;
+    }
+    silentSamples += numSamples;
+    return true;
+  }
+
+  bool isBypassed () const {return bypassed;}
+  long long getBypassedBlocks () const {return bypassedBlocks;}
+
+  // forget the silence so far, e.g. after the node was reset
+  void reset () {
+    silentSamples = 0;
+    bypassed = false;
+  }
+
+private:
+  int tailLength;
+  float threshold = 0.f;
+  long long silentSamples = 0;
+  long long bypassedBlocks = 0;
+  bool bypassed = false;
+};
@@ -3,29 +3,37 @@
 Implementation of an intermediary buffer to capture and store samples from
 an audio buffer and use them for an oscilliscope
 
+Writes are circular, so a sample costs O(1) instead of shifting the whole
+buffer. readSample(0) is still the oldest sample and
+readSample(bufferSize - 1) the newest.
+
 To Do:
 -initialize bufferSize in terms of sampleRate
 */
 
+#pragma once
+
 class ScopeBuffer {
 public:
-  // ScopeBuffer (int samplerate) {
-  //   sampleRate = samplerate;
-  // }
+  ScopeBuffer (int samprate) : sampleRate(samprate) {}
 
   void writeSample (float sample) {
-    for (int i = 0; i < bufferSize - 1; i++) {
-      buffer[i] = buffer[i + 1];
-    }
-    buffer[bufferSize - 1] = sample;
+    buffer[writeIndex] = sample;
+    writeIndex = (writeIndex + 1) % bufferSize;
   }
 
   float readSample (int index) {
-    return buffer[index];
+    return buffer[(writeIndex + index) % bufferSize];
+  }
+
+  // flat line, instead of writing a buffer of zeros sample by sample
+  void clear () {
+    for (float& sample : buffer) { sample = 0.f; }
   }
     
 protected:
   int sampleRate;
-  static const int bufferSize = 44100;
-  float buffer[bufferSize];
-};
\ No newline at end of file
+  static const int bufferSize = 44100; // <- set equal to samplerate
+  float buffer[bufferSize] = {};
+  int writeIndex = 0;
+};
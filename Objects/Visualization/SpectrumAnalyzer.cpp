@@ -0,0 +1,164 @@
+/*
+Implementation of an off-thread FFT spectrum analyzer.
+
+The audio thread only copies blocks into a lock-free tap (writeBlock).
+A worker thread drains the tap, applies a Hann window, runs a real FFT and
+keeps an averaged magnitude spectrum plus a decaying peak hold, both
+resampled onto numPoints log-spaced frequencies for drawing.
+
+The hop between analyses follows the frame time passed to setFrameTime(),
+so the worker computes about two spectra per video frame and no more.
+
+TO-DO:
+-make fftSize adjustable after start()
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Frequency-Domain/FFT.cpp"
+#include "../Utility/SPSCRing.cpp"
+
+class SpectrumAnalyzer {
+public:
+  SpectrumAnalyzer (int samprate, int size = 4096, int points = 512) :
+  sampleRate(samprate), fftSize(size), numPoints(points),
+  tap(samprate), fft(size), history(size, 0.f), window(size), windowed(size),
+  spectrum(fft.getNumBins()), magnitudes(size / 2 + 1, -120.f),
+  averaged(points, -120.f), peaks(points, -120.f),
+  sharedAveraged(points, -120.f), sharedPeaks(points, -120.f) {
+    for (int i = 0; i < fftSize; i++) { // hann window, normalized for unity sine peak
+      window[i] = 0.5f - 0.5f * cosf(2.f * M_PI * i / fftSize);
+    }
+    windowGain = 2.f / (0.5f * fftSize);
+    hopSize = fftSize / 4;
+  }
+
+  ~SpectrumAnalyzer () {stop();}
+
+  void start () {
+    if (running) { return; }
+    running = true;
+    worker = std::thread([this] { this->run(); });
+  }
+
+  void stop () {
+    running = false;
+    if (worker.joinable()) { worker.join(); }
+  }
+
+  // audio thread: block copy only, drops samples if the worker falls behind
+  void writeBlock (const float* block, int numSamples) {
+    tap.write(block, numSamples);
+  }
+
+  // GUI thread: choose a hop that gives ~2 analyses per frame
+  void setFrameTime (double dt) {
+    int hop = static_cast<int>(dt * sampleRate / 2.0);
+    hop = std::max(fftSize / 8, std::min(hop, fftSize));
+    hopSize.store(hop);
+  }
+
+  // GUI thread, like setFrameTime
+  void setAveraging (float coef) {averaging.store(coef);} // 0 = none, ->1 = slow
+  void setPeakDecay (float dBPerAnalysis) {peakDecay.store(dBPerAnalysis);}
+
+  // GUI thread: copy the latest averaged and peak-hold spectra in dB
+  void copySpectrum (std::vector<float>& avgOut, std::vector<float>& peakOut) {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    avgOut = sharedAveraged;
+    peakOut = sharedPeaks;
+  }
+
+  // frequency in Hz drawn at point i, for axis labels
+  float pointFrequency (int i) const {
+    return minFreq * powf(maxFreq() / minFreq, i / static_cast<float>(numPoints - 1));
+  }
+
+  int getNumPoints () const {return numPoints;}
+
+protected:
+  void run () {
+    std::vector<float> incoming(fftSize);
+    int sinceLast = 0;
+    while (running) {
+      int hop = hopSize.load();
+      int ready = tap.read(incoming.data(), std::min(hop - sinceLast, fftSize));
+      if (ready > 0) { // slide history left, append new samples
+        std::move(history.begin() + ready, history.end(), history.begin());
+        std::copy(incoming.begin(), incoming.begin() + ready, history.end() - ready);
+        sinceLast += ready;
+      }
+      if (sinceLast >= hop) {
+        analyze();
+        sinceLast = 0;
+      } else if (ready == 0) { // wait for roughly half a hop of audio
+        std::this_thread::sleep_for(std::chrono::microseconds(
+          static_cast<long>(500000.0 * hop / sampleRate)));
+      }
+    }
+  }
+
+  void analyze () {
+    for (int i = 0; i < fftSize; i++) { windowed[i] = history[i] * window[i]; }
+    fft.forward(windowed.data(), spectrum.data()); // <- bins 0..N/2 only
+    for (int k = 0; k <= fftSize / 2; k++) {
+      float mag = std::abs(spectrum[k]) * windowGain;
+      magnitudes[k] = 20.f * log10f(mag + 1e-9f);
+    }
+
+    // resample onto log-frequency points, taking the max of covered bins
+    float smooth = averaging.load(); // <- once per analysis, so a change can't land mid-spectrum
+    float decay = peakDecay.load();
+    float binWidth = sampleRate / static_cast<float>(fftSize);
+    for (int i = 0; i < numPoints; i++) {
+      float lo = pointFrequency(i) / binWidth;
+      float hi = (i + 1 < numPoints) ? pointFrequency(i + 1) / binWidth : lo + 1.f;
+      int first = std::min(static_cast<int>(lo), fftSize / 2);
+      int last = std::min(std::max(static_cast<int>(hi), first), fftSize / 2);
+      float dB = magnitudes[first];
+      for (int k = first + 1; k <= last; k++) { dB = std::max(dB, magnitudes[k]); }
+      averaged[i] = smooth * averaged[i] + (1.f - smooth) * dB;
+      peaks[i] = std::max(peaks[i] - decay, averaged[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(sharedMutex); // <- only shared with the GUI thread
+    sharedAveraged = averaged;
+    sharedPeaks = peaks;
+  }
+
+  float maxFreq () const {return sampleRate / 2.f;}
+
+  int sampleRate;
+  int fftSize;
+  int numPoints;
+  const float minFreq = 20.f;
+  float windowGain;
+  std::atomic<float> averaging{0.8f};
+  std::atomic<float> peakDecay{0.5f};
+  std::atomic<int> hopSize;
+  std::atomic<bool> running{false};
+
+  SPSCRing<float> tap; // <- one second of headroom
+  RealFFT fft;
+  std::vector<float> history;
+  std::vector<float> window;
+  std::vector<float> windowed;
+  std::vector<std::complex<float>> spectrum;
+  std::vector<float> magnitudes;
+  std::vector<float> averaged;
+  std::vector<float> peaks;
+
+  std::mutex sharedMutex;
+  std::vector<float> sharedAveraged;
+  std::vector<float> sharedPeaks;
+  std::thread worker;
+};